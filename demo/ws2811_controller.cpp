@@ -25,11 +25,26 @@
 
 // Define the port at which the signal will be sent. The port needs to
 // be known at compilation time, the pin (0-7) can be chosen at run time.
+// Strings on other ports can be driven from the same program by giving the port as template
+// argument, e.g.: send<ws2811::port_b>( leds, channel);
 #define WS2811_PORT PORTC
 
+// Uncomment this to use Timer1 to keep track of how long the data line has been low, so that
+// send() doesn't have to wait the full 40us reset time if rendering took long enough. The clock
+// must be started with ws2811::timer1_clock::init().
+//#define WS2811_LATCH_CLOCK ws2811::timer1_clock
+
+// Uncomment this to let run_effect() sleep between frames, woken by Timer1, instead of using a
+// busy-waiting delay. This also needs ws2811::timer1_clock::init() and an interrupt handler for
+// the Timer1 compare match: EMPTY_INTERRUPT( TIMER1_COMPA_vect);
+//#define WS2811_IDLE_CLOCK ws2811::timer1_clock
+
 // send RGB in R,G,B order instead of the standard WS2811 G,R,B order.
 // Most ws2811 LED strips take their colors in GRB order, while some LED strings
 // take them in RGB. Default is GRB, define this symbol for RGB.
+// If strings with different color orders are attached to different pins, leave this
+// undefined and use the send() overload that takes a color order, e.g.:
+// send( leds, channel, ws2811::order_rgb);
 //#define STRAIGHT_RGB
 
 #include "effects/chasers.hpp"
@@ -37,6 +52,8 @@
 #include "effects/color_cycle.hpp"
 #include "effects/water_torture.hpp"
 #include "effects/campfire.hpp"
+#include "effects/rainbow.hpp"
+#include "ws2811/dither.hpp"
 
 namespace {
 
@@ -57,9 +74,19 @@ int main()
 
 
     //campfire( leds, channel);
+    //noise_fire( leds, channel);
     water_torture::animate<3>( leds, channel);
     //flares::flares<10>( leds, channel);
+
+    // flares with smoother fades at low intensities. This needs 6 bytes of RAM per LED, on top of the
+    // leds array, so led_count may have to be reduced (see ws2811/dither.hpp).
+    // The buffer is re-sent every 5ms to keep the dithering running:
+    //static ws2811::hires_leds<led_count> hires_leds;
+    //static flares::effect<10, ws2811::hires_leds<led_count> > flaring;
+    //ws2811::run_dithered( flaring, hires_leds, channel);
+
     //chasers( leds, channel);
     //color_cycle::color_cycle(pattern, leds, channel);
+    //rainbow::rainbow( leds, channel);
 
 }
@@ -19,6 +19,8 @@ namespace {
 	/// transmit on bit 4
 	const uint8_t channel = 4;
 	const uint8_t led_string_size = 60;
+	// buffer.peak holds the highest number of bytes that was used and buffer.overflows counts the LED
+	// writes that did not fit, these can be inspected in a debugger to tune the buffer size.
 	typedef sparse_leds<38, led_string_size> buffer_type;
 	buffer_type buffer;
 
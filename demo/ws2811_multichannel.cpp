@@ -0,0 +1,69 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Demonstration of the scheduler, which runs a different effect on each of three pins of the same port.
+ * This requires a device with a Timer1 and enough RAM for three LED strings, such as the atmega88.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+
+#define WS2811_PORT PORTC
+#define WS2811_LATCH_CLOCK ws2811::timer1_clock
+// sleep between frames instead of polling the clock.
+#define WS2811_IDLE_CLOCK ws2811::timer1_clock
+
+#include "effects/chasers.hpp"
+#include "effects/flares.hpp"
+#include "effects/water_torture.hpp"
+#include "ws2811/scheduler.hpp"
+
+using ws2811::rgb;
+using ws2811::timer1_clock;
+
+namespace {
+
+static const uint16_t led_count = 50;
+
+rgb leds1[led_count];
+rgb leds2[led_count];
+rgb leds3[led_count];
+
+typedef chaser<rgb[led_count]> chaser_type;
+chaser_type chasers_array[] = {
+        chaser_type( rgb( 50, 75, 15), 0),
+        chaser_type( rgb( 255, 0,0), 25)
+};
+
+chasers_effect<rgb[led_count], chaser_type[2]>  chasing( chasers_array);
+flares::effect<10, rgb[led_count]>               flaring;
+water_torture::effect<2, rgb[led_count]>        dripping;
+
+ws2811::effect_task< chasers_effect<rgb[led_count], chaser_type[2]>, rgb[led_count]>
+        task1( chasing, leds1, 0, chasing.frame_ms * timer1_clock::ticks_per_ms);
+ws2811::effect_task< flares::effect<10, rgb[led_count]>, rgb[led_count]>
+        task2( flaring, leds2, 1, flaring.frame_ms * timer1_clock::ticks_per_ms);
+ws2811::effect_task< water_torture::effect<2, rgb[led_count]>, rgb[led_count]>
+        task3( dripping, leds3, 2, dripping.frame_ms * timer1_clock::ticks_per_ms);
+
+ws2811::task * const tasks[] = { &task1, &task2, &task3};
+}
+
+// wakes the controller from its sleep between frames, see ws2811/clock.hpp.
+EMPTY_INTERRUPT( TIMER1_COMPA_vect);
+
+int main()
+{
+    DDRC = _BV(0) | _BV(1) | _BV(2);
+    timer1_clock::init();
+
+    // the achieved frame rates can be inspected with scheduler.frame_rate( n). If WS2811_PROFILE_CLOCK
+    // is defined, render and send times per pin can be found in ws2811::profile( n).
+    ws2811::scheduler<timer1_clock, 3> scheduler( tasks);
+    scheduler.run();
+}
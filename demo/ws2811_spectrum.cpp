@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Demonstration of audio-reactive LEDs: a spectrum display of the audio on ADC input 0.
+ *
+ * The audio signal should be biased to half the supply voltage, e.g. the output of an electret microphone
+ * amplifier. This requires a device with an ADC, such as the atmega88.
+ *
+ * Every 128 samples (26.6ms) the band analyser updates its levels and a new frame is rendered and sent.
+ * With 60 LEDs, analysing, rendering and sending take about 12ms of each 26.6ms block.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define WS2811_PORT PORTC
+
+#include "ws2811/ws2811.h"
+#include "ws2811/adc_sampler.hpp"
+#include "ws2811/band_analyser.hpp"
+#include "effects/spectrum.hpp"
+
+using ws2811::rgb;
+
+namespace {
+
+// selects the pin (the bit of the chosen port).
+static const uint8_t 	channel = 4;
+
+// the ADC input that the audio signal is connected to.
+static const uint8_t    audio_input = 0;
+
+// the number of LEDs in the string.
+static const uint16_t 	led_count = 60;
+
+static const uint8_t    band_count = 8;
+
+/// center frequencies of the bands, roughly 2/3 of an octave apart.
+const uint16_t frequencies[band_count] = { 100, 160, 250, 400, 630, 1000, 1600, 2300};
+
+typedef ws2811::band_analyser<band_count> analyser_type;
+
+rgb leds[led_count];
+ws2811::sample_buffer<64> samples;
+analyser_type analyser;
+spectrum::effect<rgb[led_count], analyser_type, band_count> display( analyser);
+}
+
+ISR( ADC_vect)
+{
+    samples.push( ADCH);
+}
+
+int main()
+{
+    DDRC = _BV(channel);
+    for (uint8_t band = 0; band < band_count; ++band)
+    {
+        analyser.set_band( band, frequencies[band], ws2811::adc_sample_rate);
+    }
+    ws2811::adc_init( audio_input);
+    sei();
+
+    for (;;)
+    {
+        if (samples.available() && analyser.add( samples.pop()) && display.step())
+        {
+            display.render( leds);
+            // keep taking samples while the LEDs are sent.
+            send_interruptible( leds, channel);
+        }
+    }
+}
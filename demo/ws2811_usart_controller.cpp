@@ -0,0 +1,52 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+/**
+ * Demonstration of a controller that receives its LED frames from a host over
+ * the USART, using the Adalight protocol. This requires a device with a USART and
+ * enough RAM for two frames, such as the atmega88.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define WS2811_PORT PORTC
+
+#include "ws2811/ws2811.h"
+#include "ws2811/usart_receiver.hpp"
+
+namespace {
+
+// selects the pin (the bit of the chosen port).
+static const uint8_t 	channel = 4;
+
+// the number of LEDs in the string.
+static const uint16_t 	led_count = 60;
+
+ws2811::frame_receiver<led_count> receiver;
+}
+
+ISR( USART_RX_vect)
+{
+    // while LEDs are sent, more than one byte may have arrived since the last interrupt.
+    while (UCSR0A & _BV( RXC0)) receiver.receive( UDR0);
+}
+
+int main()
+{
+    DDRC = _BV(channel);
+    ws2811::usart_init( 500000);
+    sei();
+
+    for (;;)
+    {
+        if (receiver.frame_ready())
+        {
+            receiver.swap();
+            send_interruptible( receiver.front_buffer(), channel);
+        }
+    }
+}
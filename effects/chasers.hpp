@@ -12,6 +12,8 @@
 #include <avr/pgmspace.h>
 
 #include "ws2811/ws2811.h"
+#include "ws2811/effect.hpp"
+#include "ws2811/fade.hpp"
 using ws2811::rgb;
 
 namespace
@@ -51,6 +53,17 @@ public:
 		draw( leds);
 	}
 
+	/// Make one animation step, without drawing.
+	void step( )
+	{
+		static const uint8_t size = ws2811::led_buffer_traits<buffer_type>::count;
+		if (++position >= size)
+		{
+			position = -(size-1);
+		}
+
+	}
+
 	/**
 	 * Only draw the current state to the given led string, don't animate.
 	 */
@@ -60,10 +73,27 @@ public:
 		static const uint8_t amplitude_count = sizeof amplitudes/sizeof amplitudes[0];
 		pos_type pos = position;
 		uint16_t accumulator = 0;
+
+		// collect the tail in runs of adjacent LEDs and add each run in one go, which is
+		// much cheaper than adding LEDs one by one for sparse buffers.
+		rgb run[tail_count];
+		uint8_t length = 0;
+		bool descending = true;
+		pos_type last = 0;
 		while (accumulator/tail_count < amplitude_count)
 		{
-			rgb &loc = get(leds, abs( pos));
-			loc = add_clipped( loc, scale( color,  pgm_read_byte(&amplitudes[accumulator/tail_count])));
+			const pos_type led = abs( pos);
+			if (length == 1 && (led == last - 1 || led == last + 1))
+			{
+				descending = led < last;
+			}
+			else if (length && led != (descending ? last - 1 : last + 1))
+			{
+				add_tail( leds, run, length, last, descending);
+				length = 0;
+			}
+			run[length++] = scale( color,  pgm_read_byte(&amplitudes[accumulator/tail_count]));
+			last = led;
 			accumulator += amplitude_count;
 			--pos;
 			if( pos == -size)
@@ -71,6 +101,18 @@ public:
 				pos = size -1;
 			}
 		}
+		add_tail( leds, run, length, last, descending);
+	}
+
+	/**
+	 * Only draw the first led of the chaser. Together with fading the whole
+	 * buffer every frame, this draws a chaser with a trail.
+	 */
+	template< typename target_type>
+	void draw_head( target_type &leds) const
+	{
+		rgb &loc = get(leds, abs( position));
+		loc = add_clipped( loc, color);
 	}
 
 	chaser( const rgb &color, pos_type position)
@@ -121,39 +163,124 @@ private:
 				);
 	}
 
+	/// add a run of tail colors that ends at LED 'last'. The run is given in drawing order, which
+	/// runs from high to low LED indices if 'descending' is true.
+	static void add_tail( buffer_type &leds, rgb *run, uint8_t length, pos_type last, bool descending)
+	{
+		if (descending)
+		{
+			for (uint8_t low = 0, high = length - 1; low < high; ++low, --high)
+			{
+				const rgb temp = run[low];
+				run[low] = run[high];
+				run[high] = temp;
+			}
+			add_run( leds, last, run, length);
+		}
+		else
+		{
+			add_run( leds, last - length + 1, run, length);
+		}
+	}
+
 	/// return the absolute value of the given position.
 	static pos_type abs( pos_type pos)
 	{
 		return (pos < 0)?-pos:pos;
 	}
 
+};
 
-	/// Make one animation step.
-	void step( )
+/**
+ * A set of chasers that animate together on one LED string.
+ *
+ * The chasers themselves are kept in an array that is owned by the caller.
+ */
+template<typename buffer_type, typename chaser_array>
+class chasers_effect
+{
+public:
+	static const uint8_t frame_ms = 25;
+
+	explicit chasers_effect( chaser_array &chasers_array)
+	:chasers_array( chasers_array)
+	{}
+
+	/// move all chasers one step.
+	bool step()
 	{
-		static const uint8_t size = ws2811::led_buffer_traits<buffer_type>::count;
-		if (++position >= size)
+		for ( uint8_t idx = 0; idx < sizeof chasers_array/sizeof chasers_array[0]; ++idx)
 		{
-			position = -(size-1);
+			chasers_array[idx].step();
 		}
+		return true;
+	}
 
+	/// draw all chasers.
+	void render( buffer_type &buffer) const
+	{
+		clear( buffer);
+		for ( uint8_t idx = 0; idx < sizeof chasers_array/sizeof chasers_array[0]; ++idx)
+		{
+			chasers_array[idx].draw( buffer);
+		}
 	}
 
+private:
+	chaser_array &chasers_array;
 };
 
+/**
+ * Chasers with trails that are created by fading a frame every step.
+ *
+ * Instead of clearing the frame and drawing the complete tail of each chaser, step() fades a frame that
+ * the effect owns and then only draws the first led of each chaser into it. render() copies that frame
+ * into the buffer, so renders can be skipped or repeated. The price is 3 bytes of RAM per LED, on top
+ * of the LED buffer.
+ */
 template<typename buffer_type, typename chaser_array>
-inline void chasers( buffer_type &buffer, chaser_array &chasers_array, uint8_t channel)
+class fading_chasers_effect
 {
-	for(;;)
+public:
+	static const uint8_t frame_ms = 25;
+
+	/// the trail of a chaser becomes dimmer by factor/256 with every led.
+	explicit fading_chasers_effect( chaser_array &chasers_array, uint8_t factor = 180)
+	:chasers_array( chasers_array), factor( factor)
+	{}
+
+	bool step()
 	{
-		clear( buffer);
+		fade( trails, factor);
 		for ( uint8_t idx = 0; idx < sizeof chasers_array/sizeof chasers_array[0]; ++idx)
 		{
-			chasers_array[idx].step( buffer);
+			chasers_array[idx].step();
+			chasers_array[idx].draw_head( trails);
+		}
+		return true;
+	}
+
+	void render( buffer_type &buffer) const
+	{
+		for (uint16_t led = 0; led < led_count; ++led)
+		{
+			get( buffer, led) = trails[led];
 		}
-		send( buffer, channel);
-		_delay_ms( 25);
 	}
+
+private:
+	static const uint16_t led_count = ws2811::led_buffer_traits<buffer_type>::count;
+
+	chaser_array &chasers_array;
+	uint8_t factor;
+	rgb trails[led_count];
+};
+
+template<typename buffer_type, typename chaser_array>
+inline void chasers( buffer_type &buffer, chaser_array &chasers_array, uint8_t channel)
+{
+	chasers_effect<buffer_type, chaser_array> effect( chasers_array);
+	ws2811::run_effect( effect, buffer, channel);
 }
 
 template<typename buffer_type>
@@ -7,8 +7,8 @@
 
 #ifndef COLOR_CYCLE_HPP_
 #define COLOR_CYCLE_HPP_
-#include <util/delay.h>
 #include "ws2811/ws2811.h"
+#include "ws2811/effect.hpp"
 
 namespace color_cycle
 {
@@ -16,33 +16,37 @@ namespace color_cycle
 template< uint16_t size>
 void scroll( ws2811::rgb new_value, ws2811::rgb (&range)[size])
 {
-    for (uint8_t idx = size-1; idx != 0 ; --idx)
-    {
-        range[idx] = range[idx -1];
-    }
-    range[0] = new_value;
+    ws2811::scroll( range, new_value);
 }
 
 template< uint16_t led_count>
-void animate( const ws2811::rgb &new_value, ws2811::rgb (&leds)[led_count], uint8_t channel)
+void animate( const ws2811::rgb &new_value, ws2811::rgb (&leds)[led_count], uint8_t channel, ws2811::frame_timer &timer)
 {
     scroll( new_value, leds);
     send( leds, channel);
-    _delay_ms( 40);
+    timer.wait( 40);
+}
+
+template< uint16_t led_count>
+void animate( const ws2811::rgb &new_value, ws2811::rgb (&leds)[led_count], uint8_t channel)
+{
+    ws2811::frame_timer timer;
+    animate( new_value, leds, channel, timer);
 }
 
 template<uint8_t count, uint16_t led_count>
 void color_cycle( const ws2811::rgb (&sequence)[count], ws2811::rgb (&leds)[led_count], uint8_t channel)
 {
+	ws2811::frame_timer timer;
 	for (;;)
 	{
 		for (uint8_t idx = 0; idx != count; ++idx)
 		{
-			animate( sequence[idx], leds, channel);
+			animate( sequence[idx], leds, channel, timer);
 		}
 		for (uint8_t idx = count; idx != 0; --idx)
 		{
-			animate( sequence[idx-1], leds, channel);
+			animate( sequence[idx-1], leds, channel, timer);
 		}
 
 	}
@@ -11,6 +11,7 @@
 #include <util/delay.h>
 
 #include "ws2811/ws2811.h"
+#include "ws2811/effect.hpp"
 
 namespace flares
 {
@@ -63,32 +64,16 @@ public:
 	pos_type amplitude;
 	int8_t   speed;
 
-private:
-
-	/// multiply an 8-bit value with an 8.8 bit fixed point number.
-	/// multiplier should not be higher than 1.00 (or 256).
-	static uint8_t mult(uint8_t value, uint16_t multiplier)
-	{
-		return (static_cast<uint16_t>(value) * multiplier) >> 8;
-	}
-
-	rgb calculate(const ws2811::rgb &base_color) const
-	{
-		return rgb(
-				base_color.red   + mult(color.red,   amplitude),
-				base_color.green + mult(color.green, amplitude),
-				base_color.blue  + mult(color.blue,  amplitude));
-	}
-
-	void set(buffer_type &leds, const ws2811::rgb &base_color, int8_t directionFilter) const
+	void set(buffer_type &leds, const ws2811::rgb &base_color, int8_t directionFilter = 0) const
 	{
 	    if (speed * directionFilter >= 0)
 	    {
-            rgb &myled = get(leds, position);
-            myled = calculate( base_color);
+	        // buffers with more than 8 bits per channel keep the fraction, see dither.hpp.
+	        set_scaled( leds, position, color, amplitude, base_color);
 	    }
 	}
 
+	/// Calculate the next amplitude of this flare, without drawing.
 	void step()
 	{
 		if (speed < 0 && static_cast<uint16_t>(-speed) > amplitude)
@@ -158,6 +143,32 @@ int16_t find_free_led( buffer_type &leds)
     return -1;
 }
 
+/**
+ * Find a random led that is not occupied by any active flare.
+ * Returns -1 if no such LED was found within a limited number of tries.
+ */
+template< typename buffer_type, typename flare_type, uint8_t flare_count>
+int16_t find_free_led( const flare_type (&flares)[flare_count])
+{
+    static const uint16_t count = ws2811::led_buffer_traits< buffer_type>::count;
+    uint8_t tryLeds = 100;
+    while (tryLeds--)
+    {
+        uint16_t position = find_random_led( count);
+        uint8_t idx = 0;
+        while (idx < flare_count &&
+                !(flares[idx].position == position && (flares[idx].amplitude || flares[idx].speed > 0)))
+        {
+            ++idx;
+        }
+        if (idx == flare_count)
+        {
+            return position;
+        }
+    }
+    return -1;
+}
+
 template<typename buffer_type, uint8_t flare_count>
 void flares_step(
         buffer_type &leds,
@@ -187,20 +198,82 @@ void flares_step(
     }
 }
 
+/**
+ * The complete flares animation: a number of flares that light up at random
+ * positions on top of a background of base_color.
+ */
 template<uint8_t flare_count, typename buffer_type>
-void flares(buffer_type &leds, uint8_t channel)
+class effect
 {
-    flares::flare<buffer_type, uint8_t> flares[flare_count];
-    fill( leds, base_color);
-    uint8_t current_flare = 0;
-    uint8_t flare_pause = 1;
+public:
+    static const uint8_t frame_ms = 30;
+
+    effect()
+    :current_flare( 0), flare_pause( 1), first_frame( true)
+    {}
 
-    while (true)
+    /// start new flares and calculate the next amplitude of the active ones.
+    bool step()
     {
-        flares_step( leds, flares, current_flare, flare_pause);
-        send( leds, channel);
-        _delay_ms( 30);
+        if (flare_pause)
+        {
+            --flare_pause;
+        }
+        else
+        {
+            if (!flares[current_flare].amplitude)
+            {
+                create_random_flare(
+                        flares[current_flare],
+                        find_free_led<buffer_type>( flares),
+                        random_color());
+                flare_pause = my_rand() % 11;
+            }
+            ++current_flare;
+        }
+        if (current_flare >= flare_count) current_flare = 0;
+
+        // the background needs to be drawn at least once.
+        bool changed = first_frame;
+        first_frame = false;
+        for (uint8_t idx = 0; idx < flare_count; ++idx)
+        {
+            if (flares[idx].speed != 0)
+            {
+                // a flare that has just dimmed completely still needs to be drawn once.
+                const bool was_lit = flares[idx].amplitude;
+                flares[idx].step();
+                changed = changed || was_lit || flares[idx].amplitude;
+            }
+        }
+        return changed;
     }
+
+    /// draw the background and all flares.
+    void render( buffer_type &leds) const
+    {
+        fill( leds, base_color);
+        for (uint8_t idx = 0; idx < flare_count; ++idx)
+        {
+            if (flares[idx].speed != 0)
+            {
+                flares[idx].set( leds, base_color);
+            }
+        }
+    }
+
+private:
+    flares::flare<buffer_type, uint8_t> flares[flare_count];
+    uint8_t current_flare;
+    uint8_t flare_pause;
+    bool    first_frame;
+};
+
+template<uint8_t flare_count, typename buffer_type>
+void flares(buffer_type &leds, uint8_t channel)
+{
+    effect<flare_count, buffer_type> flares;
+    ws2811::run_effect( flares, leds, channel);
 }
 
 } // end namespace flares
@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Keyframe animation: crossfade through a sequence of frames that are stored in flash memory or in RAM.
+ */
+
+#ifndef KEYFRAMES_HPP_
+#define KEYFRAMES_HPP_
+#include <avr/pgmspace.h>
+#include "ws2811/ws2811.h"
+#include "ws2811/crossfade.hpp"
+#include "ws2811/effect.hpp"
+
+namespace keyframes
+{
+using ws2811::rgb;
+
+/**
+ * Fades from each keyframe to the next in fade_steps frames, shows each keyframe for hold_steps frames and
+ * then starts again at the first keyframe. The first fade starts from black.
+ *
+ * The fade uses the deltas of crossfade.hpp, which are calculated once per keyframe, so a step costs
+ * no multiplications. step() moves a frame that the effect owns towards the next keyframe and render()
+ * only copies that frame into the buffer, so renders can be skipped or repeated and any buffer type works.
+ * The price is RAM: 12 bytes per LED, on top of the LED buffer.
+ */
+template< typename buffer_type>
+class effect
+{
+public:
+    static const uint8_t frame_ms = 10;
+    static const uint16_t led_count = ws2811::led_buffer_traits<buffer_type>::count;
+
+    /**
+     * frames points to frame_count frames of led_count values each, in flash or, if in_flash is false, in RAM.
+     * Frames in RAM must remain valid for as long as the effect runs.
+     */
+    effect( const rgb *frames, uint8_t frame_count, uint16_t fade_steps, uint16_t hold_steps = 0, bool in_flash = true)
+    :frames( frames), frame_count( frame_count), next_frame( 0),
+     fade_steps( fade_steps), hold_steps( hold_steps), hold( 0), in_flash( in_flash)
+    {}
+
+    bool step()
+    {
+        if (fader.done())
+        {
+            if (hold)
+            {
+                --hold;
+                return false;
+            }
+            start_fade();
+        }
+
+        fader.step( current);
+        if (fader.done()) hold = hold_steps;
+        return true;
+    }
+
+    void render( buffer_type &leds) const
+    {
+        for (uint16_t led = 0; led < led_count; ++led)
+        {
+            get( leds, led) = current[led];
+        }
+    }
+
+private:
+    void start_fade()
+    {
+        const rgb *target = frames + next_frame * led_count;
+        if (in_flash)
+        {
+            fader.start_P( current, target, fade_steps);
+        }
+        else
+        {
+            fader.start( current, *reinterpret_cast<const rgb (*)[led_count]>( target), fade_steps);
+        }
+        if (++next_frame >= frame_count) next_frame = 0;
+    }
+
+    ws2811::crossfade<led_count> fader;
+    rgb         current[led_count];
+    const rgb   *frames;
+    uint8_t     frame_count;
+    uint8_t     next_frame;
+    uint16_t    fade_steps;
+    uint16_t    hold_steps;
+    uint16_t    hold;
+    bool        in_flash;
+};
+
+/// run a keyframe animation with frames in flash, forever.
+template< typename buffer_type>
+void keyframes( const rgb *frames, uint8_t frame_count, uint16_t fade_steps, buffer_type &leds, uint8_t channel, uint16_t hold_steps = 0)
+{
+    effect<buffer_type> animation( frames, frame_count, fade_steps, hold_steps);
+    ws2811::run_effect( animation, leds, channel);
+}
+
+}
+
+#endif /* KEYFRAMES_HPP_ */
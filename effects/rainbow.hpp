@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * A rainbow that slowly rotates along the led string.
+ */
+
+#ifndef RAINBOW_HPP_
+#define RAINBOW_HPP_
+#include "ws2811/ws2811.h"
+#include "ws2811/rgb_operators.hpp"
+#include "ws2811/effect.hpp"
+
+namespace rainbow
+{
+
+template< typename buffer_type>
+class effect
+{
+public:
+    static const uint8_t frame_ms = 20;
+
+    /// value determines the brightness of the rainbow, speed the hue change per frame in 8.8 fixed point.
+    explicit effect( uint8_t value = 64, uint16_t speed = 0x0080)
+    :hue( 0), speed( speed), value( value)
+    {}
+
+    bool step()
+    {
+        hue += speed;
+        return true;
+    }
+
+    void render( buffer_type &leds) const
+    {
+        static const uint16_t hue_step = 65536L / count;
+        uint16_t led_hue = hue;
+        for (uint16_t led = 0; led < count; ++led)
+        {
+            get( leds, led) = ws2811::hsv( led_hue >> 8, 255, value);
+            led_hue += hue_step;
+        }
+    }
+
+private:
+    static const uint16_t count = ws2811::led_buffer_traits<buffer_type>::count;
+    uint16_t hue;
+    uint16_t speed;
+    uint8_t  value;
+};
+
+template< typename buffer_type>
+void rainbow( buffer_type &leds, uint8_t channel)
+{
+    effect<buffer_type> rainbow;
+    ws2811::run_effect( rainbow, leds, channel);
+}
+
+}
+
+#endif /* RAINBOW_HPP_ */
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * A spectrum display: the string is divided into one zone per frequency band and each zone shows
+ * a bar with the level of its band, in its own color. Bars jump up with the level and fall back slowly.
+ *
+ * The levels are read from a band analyser (see ws2811/band_analyser.hpp). Because frames follow the
+ * analyser's blocks rather than a fixed clock, this effect is driven by the audio loop instead of by
+ * run_effect(), see demo/ws2811_spectrum.cpp.
+ */
+
+#ifndef SPECTRUM_HPP_
+#define SPECTRUM_HPP_
+#include "ws2811/ws2811.h"
+#include "ws2811/rgb_operators.hpp"
+#include "ws2811/effect.hpp"
+
+namespace spectrum
+{
+
+template< typename buffer_type, typename analyser_type, uint8_t band_count>
+class effect
+{
+public:
+    static const uint8_t frame_ms = 27;
+
+    /**
+     * Levels at or below 'floor' show no light and levels of floor + range or above show a full bar.
+     * With 8 levels per doubling of power, the default range of 64 covers about 24dB. The default floor
+     * keeps the bands that are further than one band away from a full-scale tone dark.
+     * 'fall' is the number of 1/256ths of a bar that a bar drops per frame.
+     */
+    explicit effect( const analyser_type &analyser, uint8_t floor = 100, uint8_t range = 64, uint8_t fall = 4, uint8_t value = 64)
+    :analyser( analyser), floor( floor), range( range), fall( fall), value( value)
+    {
+        for (uint8_t band = 0; band < band_count; ++band) heights[band] = 0;
+    }
+
+    bool step()
+    {
+        bool changed = false;
+        for (uint8_t band = 0; band < band_count; ++band)
+        {
+            const uint8_t target = height( analyser.level( band));
+            const uint8_t fallen = heights[band] > fall ? heights[band] - fall : 0;
+            const uint8_t next = target > fallen ? target : fallen;
+            if (next != heights[band])
+            {
+                heights[band] = next;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    void render( buffer_type &leds) const
+    {
+        clear( leds);
+        for (uint8_t band = 0; band < band_count; ++band)
+        {
+            const uint16_t first = static_cast<uint32_t>( band) * count / band_count;
+            const uint16_t zone = static_cast<uint32_t>( band + 1) * count / band_count - first;
+            const uint16_t lit = (static_cast<uint32_t>( heights[band]) * zone + 255) / 256;
+            const ws2811::rgb color = ws2811::hsv( band * (256 / band_count), 255, value);
+            for (uint16_t led = 0; led < lit; ++led)
+            {
+                get( leds, first + led) = color;
+            }
+        }
+    }
+
+private:
+    static const uint16_t count = ws2811::led_buffer_traits<buffer_type>::count;
+
+    /// bar height in 1/256ths of the zone.
+    uint8_t height( uint8_t level) const
+    {
+        if (level <= floor) return 0;
+        const uint16_t above = level - floor;
+        return above >= range ? 255 : above * 255 / range;
+    }
+
+    const analyser_type &analyser;
+    uint8_t heights[band_count];
+    uint8_t floor;
+    uint8_t range;
+    uint8_t fall;
+    uint8_t value;
+};
+
+}
+
+#endif /* SPECTRUM_HPP_ */
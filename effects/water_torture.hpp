@@ -9,6 +9,7 @@
 #define WATER_TORTURE_HPP_
 #include <util/delay.h>
 #include "ws2811/ws2811.h"
+#include "ws2811/effect.hpp"
 
 namespace water_torture
 {
@@ -105,7 +106,7 @@ namespace water_torture
 		/// This will "smear" the light of this droplet between two leds. The closer
 		/// the droplets position is to that of a particular led, the brighter that
 		/// led will be
-		void draw( buffer_type &leds)
+		void draw( buffer_type &leds) const
 		{
 			static uint8_t max_pos =
 					ws2811::led_buffer_traits<buffer_type>::count - 1;
@@ -214,25 +215,28 @@ private:
 	  static void is_true(){};
 	};
 
-	/// Create the complete water torture animation.
+	/// The complete water torture animation.
 	/// This will render droplets at random intervals, up to a given maximum number of droplets.
 	/// The maximum led count is 256
 	template< uint8_t droplet_count, typename buffer_type>
-	void inline animate( buffer_type &leds, uint8_t channel)
+	class effect
 	{
-		static const uint16_t led_count = ws2811::led_buffer_traits<buffer_type>::count;
+	public:
+		static const uint8_t frame_ms = 1;
 
-	    // if you get an error that 'is_true' is not a member of static_assert_, you're probably using
-	    // more than 255 leds, which doesn't work for this function.
-	    static_assert_< led_count <= 255>::is_true();
+		effect()
+		:current_droplet( 0), droplet_pause( 1)
+		{
+			static const uint16_t led_count = ws2811::led_buffer_traits<buffer_type>::count;
 
-	    typedef droplet<buffer_type, true> droplet_type;
-	    droplet_type droplets[droplet_count]; // droplets that can animate simultaneously.
-	    uint8_t current_droplet = 0; // index of the next droplet to be created
-	    uint16_t droplet_pause = 1; // how long to wait for the next one
+		    // if you get an error that 'is_true' is not a member of static_assert_, you're probably using
+		    // more than 255 leds, which doesn't work for this effect.
+		    static_assert_< led_count <= 255>::is_true();
+		}
 
-	    for(;;)
-	    {
+		/// start new droplets and let all active droplets do one step.
+		bool step()
+		{
 	    	if (droplet_pause)
 	    	{
 	    		--droplet_pause;
@@ -248,15 +252,39 @@ private:
 	    		}
 	    	}
 
+	    	// a droplet that has just become inactive still needs to be erased once.
+	    	bool changed = false;
+	    	for (uint8_t idx = 0; idx < droplet_count; ++idx)
+	    	{
+	    		changed = changed || droplets[idx].is_active();
+	    		droplets[idx].step();
+	    	}
+	    	return changed;
+		}
+
+		/// draw all droplets.
+		void render( buffer_type &leds) const
+		{
 	    	clear( leds);
 	    	for (uint8_t idx = 0; idx < droplet_count; ++idx)
 	    	{
-	    		droplets[idx].step( leds);
+	    		droplets[idx].draw( leds);
 	    	}
+		}
+
+	private:
+	    typedef droplet<buffer_type, true> droplet_type;
+	    droplet_type droplets[droplet_count]; // droplets that can animate simultaneously.
+	    uint8_t current_droplet; // index of the next droplet to be created
+	    uint16_t droplet_pause; // how long to wait for the next one
+	};
 
-	    	send( leds, channel);
-	    	_delay_ms( 1);
-	    }
+	/// Create the complete water torture animation in an infinite loop.
+	template< uint8_t droplet_count, typename buffer_type>
+	void inline animate( buffer_type &leds, uint8_t channel)
+	{
+		effect<droplet_count, buffer_type> torture;
+		ws2811::run_effect( torture, leds, channel);
 	}
 }
 
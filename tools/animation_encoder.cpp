@@ -0,0 +1,147 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Host tool that converts a sequence of images into a compressed animation for ws2811/flash_animation.hpp.
+ *
+ * Usage: animation_encoder <name> image1.ppm image2.ppm ... > animation.hpp
+ *
+ * Every image is one frame. Images must be binary PPM (P6) files with a maximum value of 255 and
+ * all images must have the same number of pixels. Pixels are assigned to LEDs in the order in which they
+ * appear in the file, i.e. row by row. The output is a C++ header that defines <name>_led_count and
+ * <name>_data[] in flash, statistics are written to standard error.
+ *
+ * This is a plain C++ program that builds with any host compiler, e.g.:
+ * g++ -O2 -o animation_encoder tools/animation_encoder.cpp
+ */
+#include <cstdio>
+#include <cctype>
+#include "delta_encoder.hpp"
+
+namespace
+{
+
+/// read the next number from a PPM header, skipping whitespace and comments.
+bool read_header_value( std::FILE *input, size_t &value)
+{
+    int c = std::fgetc( input);
+    while (c != EOF && (std::isspace( c) || c == '#'))
+    {
+        if (c == '#')
+        {
+            while (c != EOF && c != '\n') c = std::fgetc( input);
+        }
+        c = std::fgetc( input);
+    }
+
+    if (c == EOF || !std::isdigit( c)) return false;
+    value = 0;
+    while (c != EOF && std::isdigit( c))
+    {
+        value = 10 * value + (c - '0');
+        c = std::fgetc( input);
+    }
+
+    // the single whitespace character after the last header value is consumed here.
+    return true;
+}
+
+bool read_ppm( const char *filename, delta::frame &pixels)
+{
+    std::FILE *input = std::fopen( filename, "rb");
+    if (!input) return false;
+
+    size_t width = 0;
+    size_t height = 0;
+    size_t max_value = 0;
+    bool result =
+            std::fgetc( input) == 'P' && std::fgetc( input) == '6'
+        &&  read_header_value( input, width)
+        &&  read_header_value( input, height)
+        &&  read_header_value( input, max_value)
+        &&  max_value == 255;
+
+    if (result)
+    {
+        std::vector<uint8_t> raw( 3 * width * height);
+        result = !raw.empty() && std::fread( &raw[0], 1, raw.size(), input) == raw.size();
+        pixels.resize( width * height);
+        for (size_t pixel = 0; result && pixel < pixels.size(); ++pixel)
+        {
+            pixels[pixel] = delta::color( raw[3 * pixel], raw[3 * pixel + 1], raw[3 * pixel + 2]);
+        }
+    }
+
+    std::fclose( input);
+    return result;
+}
+
+}
+
+int main( int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::fprintf( stderr, "usage: %s <name> image1.ppm [image2.ppm ...] > output\n", argv[0]);
+        return 1;
+    }
+
+    const char *name = argv[1];
+    std::vector<delta::frame> images( argc - 2);
+    for (size_t image = 0; image < images.size(); ++image)
+    {
+        const char *filename = argv[image + 2];
+        if (!read_ppm( filename, images[image]))
+        {
+            std::fprintf( stderr, "could not read %s as a binary PPM file\n", filename);
+            return 1;
+        }
+        if (images[image].size() != images[0].size())
+        {
+            std::fprintf( stderr, "%s does not have %lu pixels\n", filename, static_cast<unsigned long>( images[0].size()));
+            return 1;
+        }
+    }
+
+    const size_t led_count = images[0].size();
+    const size_t frames = images.size();
+    delta::encoder encoder( led_count);
+    delta::bytes encoded;
+    for (size_t image = 0; image < frames; ++image)
+    {
+        encoder.encode( images[image], encoded);
+    }
+
+    if (encoded.size() > 0xffff)
+    {
+        std::fprintf( stderr, "animation is too large: %lu bytes\n", static_cast<unsigned long>( encoded.size()));
+        return 1;
+    }
+
+    std::printf( "// generated by animation_encoder from %lu images\n", static_cast<unsigned long>( frames));
+    std::printf( "#include <avr/pgmspace.h>\n\n");
+    std::printf( "const uint16_t %s_led_count = %lu;\n", name, static_cast<unsigned long>( led_count));
+    std::printf( "const uint8_t %s_data[] PROGMEM = {", name);
+    for (size_t idx = 0; idx < encoded.size(); ++idx)
+    {
+        std::printf( "%s0x%02x,", (idx % 16) ? " " : "\n    ", encoded[idx]);
+    }
+    std::printf( "\n};\n");
+
+    const size_t raw_size = 3 * led_count * frames;
+    std::fprintf( stderr,
+            "%lu frames of %lu leds: %lu bytes (raw: %lu bytes, ratio %.1f:1), %.1f bytes per frame\n"
+            "estimated decode time: %.0f cycles per frame\n",
+            static_cast<unsigned long>( frames),
+            static_cast<unsigned long>( led_count),
+            static_cast<unsigned long>( encoded.size()),
+            static_cast<unsigned long>( raw_size),
+            static_cast<double>( raw_size) / encoded.size(),
+            static_cast<double>( encoded.size()) / frames,
+            40.0 * encoded.size() / frames);
+    return 0;
+}
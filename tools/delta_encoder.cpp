@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Host tool that converts raw LED frames into a frame-delta stream.
+ *
+ * Usage: delta_encoder <led count> [input file] > stream
+ *
+ * The input consists of frames of <led count> R, G, B triples. If no input file is given,
+ * frames are read from standard input. The delta stream is written to standard output,
+ * statistics on the number of bytes per frame are written to standard error.
+ *
+ * This is a plain C++ program that builds with any host compiler, e.g.:
+ * g++ -O2 -o delta_encoder tools/delta_encoder.cpp
+ */
+#include <cstdio>
+#include <cstdlib>
+#include "delta_encoder.hpp"
+
+int main( int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::fprintf( stderr, "usage: %s <led count> [input file] > output\n", argv[0]);
+        return 1;
+    }
+
+    const size_t led_count = std::atoi( argv[1]);
+    std::FILE *input = argc > 2 ? std::fopen( argv[2], "rb") : stdin;
+    if (!led_count || !input)
+    {
+        std::fprintf( stderr, "invalid led count or input file\n");
+        return 1;
+    }
+
+    delta::encoder encoder( led_count);
+    std::vector<uint8_t> raw( 3 * led_count);
+    delta::frame current( led_count);
+    size_t frames = 0;
+    size_t total = 0;
+    size_t smallest = static_cast<size_t>( -1);
+    size_t largest = 0;
+
+    while (std::fread( &raw[0], 1, raw.size(), input) == raw.size())
+    {
+        for (size_t led = 0; led < led_count; ++led)
+        {
+            current[led] = delta::color( raw[3 * led], raw[3 * led + 1], raw[3 * led + 2]);
+        }
+
+        delta::bytes encoded;
+        encoder.encode( current, encoded);
+        std::fwrite( &encoded[0], 1, encoded.size(), stdout);
+
+        ++frames;
+        total += encoded.size();
+        if (encoded.size() < smallest) smallest = encoded.size();
+        if (encoded.size() > largest) largest = encoded.size();
+    }
+
+    if (frames)
+    {
+        const size_t full_frame = 6 + 3 * led_count; // adalight frame size
+        std::fprintf( stderr,
+                "%lu frames, bytes per frame: min %lu, avg %.1f, max %lu (full frame: %lu bytes, %.1f%%)\n",
+                static_cast<unsigned long>( frames),
+                static_cast<unsigned long>( smallest),
+                static_cast<double>( total) / frames,
+                static_cast<unsigned long>( largest),
+                static_cast<unsigned long>( full_frame),
+                100.0 * total / frames / full_frame);
+    }
+    return 0;
+}
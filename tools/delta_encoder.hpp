@@ -0,0 +1,237 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Host-side encoder for the frame-delta protocol that is decoded by
+ * ws2811/delta_decoder.hpp. See that file for a description of the format.
+ */
+
+#ifndef DELTA_ENCODER_HPP_
+#define DELTA_ENCODER_HPP_
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace delta
+{
+
+struct color
+{
+    color( uint8_t red = 0, uint8_t green = 0, uint8_t blue = 0)
+    :red( red), green( green), blue( blue)
+    {}
+
+    bool operator==( const color &other) const
+    {
+        return red == other.red && green == other.green && blue == other.blue;
+    }
+
+    bool operator!=( const color &other) const
+    {
+        return !(*this == other);
+    }
+
+    bool operator<( const color &other) const
+    {
+        if (red != other.red) return red < other.red;
+        if (green != other.green) return green < other.green;
+        return blue < other.blue;
+    }
+
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+typedef std::vector<color>      frame;
+typedef std::vector<uint8_t>    bytes;
+
+/**
+ * Encodes frames as differences with the previously encoded frame.
+ *
+ * The encoder assumes that the buffer of the decoder is black before the first frame and
+ * keeps a copy of the palette of the decoder, so all frames must be decoded in the order in which
+ * they were encoded.
+ */
+class encoder
+{
+public:
+    static const size_t palette_size = 16;
+    static const size_t max_count = 64;
+
+    explicit encoder( size_t led_count)
+    :previous( led_count), palette( palette_size), palette_valid( palette_size, false),
+     palette_used( palette_size, 0), frame_number( 0)
+    {}
+
+    /**
+     * Encode a frame with the frame header and end-of-frame marker.
+     */
+    void encode( const frame &current, bytes &out)
+    {
+        out.push_back( 'D');
+        out.push_back( 'e');
+        out.push_back( 'l');
+        encode_body( current, out);
+        out.push_back( 0xff);
+    }
+
+    /**
+     * Encode only the opcodes that turn the previous frame into the current one.
+     */
+    void encode_body( const frame &current, bytes &out)
+    {
+        ++frame_number;
+        update_palette( current, out);
+
+        const size_t size = previous.size();
+        size_t index = 0;
+        while (index < size)
+        {
+            if (current[index] == previous[index])
+            {
+                size_t count = 0;
+                while (index + count < size && count < max_count && current[index + count] == previous[index + count]) ++count;
+                out.push_back( count - 1);
+                index += count;
+                continue;
+            }
+
+            const size_t repeats = repeat_count( current, index);
+            const int entry = palette_entry( current[index]);
+            if (repeats >= 3 && !(entry >= 0 && repeats < 6))
+            {
+                const size_t count = repeats > 32 ? 32 : repeats;
+                out.push_back( 0xc0 | (count - 1));
+                push_color( current[index], out);
+                index += count;
+                continue;
+            }
+
+            size_t count = 0;
+            if (entry >= 0)
+            {
+                while (index + count < size && count < max_count
+                        && current[index + count] != previous[index + count]
+                        && palette_entry( current[index + count]) >= 0
+                        && (count == 0 || repeat_count( current, index + count) < 8))
+                {
+                    ++count;
+                }
+                out.push_back( 0x80 | (count - 1));
+                for (size_t pixel = 0; pixel < count; pixel += 2)
+                {
+                    uint8_t packed = palette_entry( current[index + pixel]) << 4;
+                    if (pixel + 1 < count) packed |= palette_entry( current[index + pixel + 1]);
+                    out.push_back( packed);
+                }
+            }
+            else
+            {
+                while (index + count < size && count < max_count
+                        && current[index + count] != previous[index + count]
+                        && palette_entry( current[index + count]) < 0
+                        && (count == 0 || repeat_count( current, index + count) < 3))
+                {
+                    ++count;
+                }
+                out.push_back( 0x40 | (count - 1));
+                for (size_t pixel = 0; pixel < count; ++pixel)
+                {
+                    push_color( current[index + pixel], out);
+                }
+            }
+            index += count;
+        }
+
+        previous = current;
+    }
+
+private:
+    static void push_color( const color &c, bytes &out)
+    {
+        out.push_back( c.red);
+        out.push_back( c.green);
+        out.push_back( c.blue);
+    }
+
+    static size_t repeat_count( const frame &current, size_t index)
+    {
+        size_t count = 1;
+        while (index + count < current.size() && current[index + count] == current[index]) ++count;
+        return count;
+    }
+
+    int palette_entry( const color &c)
+    {
+        for (size_t entry = 0; entry < palette_size; ++entry)
+        {
+            if (palette_valid[entry] && palette[entry] == c)
+            {
+                palette_used[entry] = frame_number;
+                return entry;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Add colors that occur often among the changed LEDs of this frame to the palette,
+     * replacing the least recently used entries.
+     * A palette definition costs at most 5 bytes, while every palette reference saves 2.5 bytes
+     * over a literal value.
+     */
+    void update_palette( const frame &current, bytes &out)
+    {
+        std::vector<color>  candidates;
+        std::vector<size_t> counts;
+        for (size_t index = 0; index < current.size(); ++index)
+        {
+            if (current[index] == previous[index]) continue;
+            size_t candidate = 0;
+            while (candidate < candidates.size() && candidates[candidate] != current[index]) ++candidate;
+            if (candidate == candidates.size())
+            {
+                candidates.push_back( current[index]);
+                counts.push_back( 0);
+            }
+            ++counts[candidate];
+        }
+
+        for (size_t candidate = 0; candidate < candidates.size(); ++candidate)
+        {
+            if (counts[candidate] < 4 || palette_entry( candidates[candidate]) >= 0) continue;
+
+            size_t victim = 0;
+            for (size_t entry = 0; entry < palette_size; ++entry)
+            {
+                if (!palette_valid[entry]) { victim = entry; break;}
+                if (palette_used[entry] < palette_used[victim]) victim = entry;
+            }
+
+            // don't evict colors that were used in this frame already
+            if (palette_valid[victim] && palette_used[victim] == frame_number) break;
+
+            palette[victim] = candidates[candidate];
+            palette_valid[victim] = true;
+            palette_used[victim] = frame_number;
+            out.push_back( 0xe0);
+            out.push_back( victim);
+            push_color( candidates[candidate], out);
+        }
+    }
+
+    frame               previous;
+    frame               palette;
+    std::vector<bool>   palette_valid;
+    std::vector<size_t> palette_used;
+    size_t              frame_number;
+};
+
+}
+
+#endif /* DELTA_ENCODER_HPP_ */
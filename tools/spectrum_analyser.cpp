@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Host tool that runs recorded audio through the band analyser of ws2811/band_analyser.hpp, with the same
+ * bands as demo/ws2811_spectrum.cpp, to tune band frequencies and the floor and range of the spectrum effect.
+ *
+ * Usage: spectrum_analyser [sample_rate] < samples.raw
+ *
+ * The input is raw, unsigned 8-bit mono audio at the sample rate of the controller, 4807Hz by default
+ * (an atmega88 at 8Mhz). Such a file can be made from any recording with e.g. sox:
+ * sox music.wav -t raw -r 4807 -c 1 -b 8 -e unsigned samples.raw
+ *
+ * For every block of samples, the output shows one line with the level of each band.
+ *
+ * This is a plain C++ program that builds with any host compiler, e.g.:
+ * g++ -O2 -o spectrum_analyser tools/spectrum_analyser.cpp
+ */
+#include <cstdio>
+#include <cstdlib>
+#include "../ws2811/band_analyser.hpp"
+
+namespace
+{
+const uint8_t band_count = 8;
+const uint16_t frequencies[band_count] = { 100, 160, 250, 400, 630, 1000, 1600, 2300};
+}
+
+int main( int argc, char *argv[])
+{
+    const long sample_rate = argc > 1 ? std::atol( argv[1]) : 4807;
+    if (argc > 2 || sample_rate <= 0 || sample_rate > 0xffff)
+    {
+        std::fprintf( stderr, "usage: %s [sample_rate] < samples.raw\n", argv[0]);
+        return 1;
+    }
+
+    ws2811::band_analyser<band_count> analyser;
+    for (uint8_t band = 0; band < band_count; ++band)
+    {
+        analyser.set_band( band, frequencies[band], static_cast<uint16_t>( sample_rate));
+        std::printf( "%6u", frequencies[band]);
+    }
+    std::printf( "\n");
+
+    unsigned long blocks = 0;
+    int sample;
+    while ((sample = std::getchar()) != EOF)
+    {
+        if (analyser.add( static_cast<uint8_t>( sample)))
+        {
+            for (uint8_t band = 0; band < band_count; ++band)
+            {
+                std::printf( "%6u", analyser.level( band));
+            }
+            std::printf( "\n");
+            ++blocks;
+        }
+    }
+
+    std::fprintf( stderr, "%lu blocks\n", blocks);
+    return 0;
+}
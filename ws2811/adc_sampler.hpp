@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Audio input through the ADC.
+ *
+ * The ADC runs in free-running mode and raises an interrupt after each conversion. The interrupt
+ * handler stores the sample in a ring buffer, from which the main loop takes samples, e.g. to feed them to a
+ * band analyser (see band_analyser.hpp). As with the USART receiver, the interrupt handler itself is defined
+ * by the application:
+ *
+ *     ws2811::sample_buffer<64> samples;
+ *     ISR( ADC_vect)
+ *     {
+ *         samples.push( ADCH);
+ *     }
+ *
+ * With the ADC clock at F_CPU/128, a conversion takes 13 ADC clock cycles, which gives a sample rate
+ * of 4807Hz at 8Mhz. The handler takes about 30 clock ticks per sample, under 2% of the CPU time.
+ *
+ * A new sample arrives every 208us, while send() keeps interrupts disabled for the whole frame.
+ * Use send_interruptible() to avoid losing samples while LEDs are being sent. Samples that arrive while the
+ * ring buffer is full are counted in 'overruns'.
+ */
+
+#ifndef ADC_SAMPLER_HPP_
+#define ADC_SAMPLER_HPP_
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+namespace ws2811
+{
+
+/// samples per second with the prescaler that adc_init() selects.
+static const uint16_t adc_sample_rate = F_CPU / 128 / 13;
+
+/**
+ * Start free-running conversions on the given ADC input, with AVcc as reference.
+ * Results are left-adjusted, so that ADCH holds the upper 8 bits of each sample.
+ */
+inline void adc_init( uint8_t input)
+{
+    ADMUX = _BV( REFS0) | _BV( ADLAR) | (input & 0x0f);
+    ADCSRB = 0; // free-running mode
+    ADCSRA = _BV( ADEN) | _BV( ADSC) | _BV( ADATE) | _BV( ADIE) | _BV( ADPS2) | _BV( ADPS1) | _BV( ADPS0);
+}
+
+/**
+ * Ring buffer between the ADC interrupt and the main loop.
+ *
+ * push() should only be called from the interrupt handler and available() and pop() only from the main loop.
+ * The size must be a power of two; the buffer holds up to size - 1 samples.
+ */
+template< uint8_t size>
+class sample_buffer
+{
+public:
+    sample_buffer()
+    :overruns( 0), head( 0), tail( 0)
+    {}
+
+    void push( uint8_t sample)
+    {
+        const uint8_t next = (head + 1) & mask;
+        if (next == tail)
+        {
+            if (overruns != 255) ++overruns;
+            return;
+        }
+        samples[head] = sample;
+        head = next;
+    }
+
+    bool available() const
+    {
+        return head != tail;
+    }
+
+    uint8_t pop()
+    {
+        const uint8_t sample = samples[tail];
+        tail = (tail + 1) & mask;
+        return sample;
+    }
+
+    /// samples that were dropped because the buffer was full, saturates at 255.
+    volatile uint8_t overruns;
+
+private:
+    static const uint8_t mask = size - 1;
+
+    // fails to compile if the size is not a power of two.
+    typedef char size_must_be_power_of_two[(size & mask) == 0 ? 1 : -1];
+
+    volatile uint8_t    samples[size];
+    volatile uint8_t    head;
+    volatile uint8_t    tail;
+};
+
+}
+
+#endif /* ADC_SAMPLER_HPP_ */
@@ -0,0 +1,216 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Fixed-point band analyser for 8-bit audio samples.
+ *
+ * The analyser measures the level of a small number of frequency bands with the Goertzel algorithm,
+ * one resonator per band. Unlike an FFT it does not need a sample buffer: every sample is processed
+ * as soon as it is available.
+ *
+ * A resonator that runs over N samples responds to frequencies within about sample_rate / N of its center.
+ * To cover the whole spectrum with bands that are spaced in octaves, every band runs over its own number of
+ * samples, which is chosen so that its width is a fixed fraction of its center frequency. High bands
+ * use a few samples, low bands up to block_size samples. Samples are weighted with a smooth window, which keeps
+ * a loud tone in one band from showing up in all other bands.
+ *
+ * Every block_size samples, add() reports new levels: for each band, the highest level that it measured
+ * since the last report. Levels are logarithmic: 8 steps per doubling of power, so one step is about
+ * 0.4dB. They are corrected for the number of samples per band, so that a tone at the center
+ * of any band gives about the same level: a full-scale tone gives about 160, a tone between two bands about 145
+ * in both. Effects can use the levels directly as parameters (see effects/spectrum.hpp).
+ *
+ * Samples are unsigned bytes, e.g. the upper 8 bits of the ADC (see adc_sampler.hpp). The DC level of
+ * the input, e.g. the bias of a microphone amplifier, is measured over each block and subtracted from
+ * the samples of the next block.
+ *
+ * The resonators use 16-bit state. To keep it from overflowing, band frequencies should lie
+ * between 1/100th of the sample rate and just below half the sample rate, and block_size should be at most 128.
+ *
+ * Estimated cost on an AVR at 8Mhz: about 75 clock ticks per band per sample, mostly for a 16x16-bit
+ * multiplication in the resonator and two 8x8-bit multiplications for the window. With 8 bands at a sample rate of
+ * 4807Hz, that is about a third of the CPU time. A band that completes its samples takes another 200 clock ticks
+ * to calculate its level. RAM use is 15 bytes per band plus 4 bytes.
+ *
+ * This header only depends on <stdint.h>, so it can be used on a host, e.g. with recorded audio
+ * (see tools/spectrum_analyser.cpp).
+ */
+
+#ifndef BAND_ANALYSER_HPP_
+#define BAND_ANALYSER_HPP_
+#include <stdint.h>
+
+namespace ws2811
+{
+
+template< uint8_t band_count, uint8_t block_size = 128>
+class band_analyser
+{
+public:
+    band_analyser()
+    :offset( 128), sum( 0), samples( 0)
+    {
+        for (uint8_t band = 0; band < band_count; ++band)
+        {
+            set( band, 0, block_size);
+            levels[band] = 0;
+        }
+    }
+
+    /**
+     * Set the center frequency of a band. Both arguments are in Hz.
+     * The band is about half as wide as its center frequency, so bands that are 2/3 octave apart
+     * touch each other. Bands that would need more than block_size samples are made wider.
+     */
+    void set_band( uint8_t band, uint16_t frequency, uint16_t sample_rate)
+    {
+        // a window of N samples passes frequencies within about 2 x sample_rate / N of the center at half
+        // the amplitude. For a band of half the center frequency, that requires about 4 x sample_rate / frequency samples.
+        const uint32_t length = frequency ? 4UL * sample_rate / frequency : block_size;
+        set( band, coefficient( frequency, sample_rate), length < 8 ? 8 : length > block_size ? block_size : length);
+    }
+
+    /**
+     * Process one sample.
+     * Returns true if this completed a block, in which case the levels of all bands were updated.
+     */
+    bool add( uint8_t sample)
+    {
+        sum += sample;
+        const int16_t x = (static_cast<int16_t>( sample) - offset) >> 1;
+        for (uint8_t band = 0; band < band_count; ++band)
+        {
+            const int16_t s0 = windowed( x, phases[band]) + static_cast<int16_t>( (static_cast<int32_t>( coefficients[band]) * s1[band]) >> 13) - s2[band];
+            s2[band] = s1[band];
+            s1[band] = s0;
+            phases[band] += phase_steps[band];
+            if (++positions[band] == lengths[band])
+            {
+                const uint8_t level = corrected( log_level( power( band)), corrections[band]);
+                if (level > peaks[band]) peaks[band] = level;
+                restart( band);
+            }
+        }
+
+        if (++samples < block_size) return false;
+
+        for (uint8_t band = 0; band < band_count; ++band)
+        {
+            levels[band] = peaks[band];
+            peaks[band] = 0;
+        }
+        offset = sum / block_size;
+        sum = 0;
+        samples = 0;
+        return true;
+    }
+
+    /// the level of a band, as measured over the last complete block.
+    uint8_t level( uint8_t band) const
+    {
+        return levels[band];
+    }
+
+private:
+    void set( uint8_t band, int16_t coefficient, uint8_t length)
+    {
+        coefficients[band] = coefficient;
+        lengths[band] = length;
+        phase_steps[band] = 0x10000UL / length;
+
+        // the power of a resonator grows with the square of its length. Levels are
+        // corrected to what the band would measure over 128 samples.
+        corrections[band] = log_level( 128L * 128) - log_level( static_cast<int32_t>( length) * length);
+        peaks[band] = 0;
+        restart( band);
+    }
+
+    void restart( uint8_t band)
+    {
+        s1[band] = 0;
+        s2[band] = 0;
+        phases[band] = phase_steps[band] / 2;
+        positions[band] = 0;
+    }
+
+    /**
+     * Weigh a sample with the window at the given phase (0-65535 for the whole window).
+     * The window is a squared parabola, which comes close to a Hann window without a table of cosines.
+     */
+    static int16_t windowed( int16_t x, uint16_t phase)
+    {
+        const uint8_t p = phase >> 8;
+        const uint8_t parabola = (static_cast<uint16_t>( p) * static_cast<uint8_t>( 255 - p)) >> 6;
+        const uint8_t window = (static_cast<uint16_t>( parabola) * parabola) >> 8;
+        return (x * window) >> 8;
+    }
+
+    /// 2 cos( 2 pi frequency / sample_rate) in 2.13 fixed point, from a Taylor series.
+    static int16_t coefficient( uint16_t frequency, uint16_t sample_rate)
+    {
+        static const int32_t one = 8192;
+        static const uint8_t denominators[] = { 90, 56, 30, 12, 2};
+
+        // 2 pi = 51472 in 2.13 fixed point.
+        const int32_t omega = static_cast<uint32_t>( frequency) * 51472UL / sample_rate;
+        const int32_t omega2 = (omega * omega) >> 13;
+        int32_t cosine = one;
+        for (uint8_t term = 0; term < sizeof denominators; ++term)
+        {
+            cosine = one - omega2 * cosine / (denominators[term] * one);
+        }
+        return static_cast<int16_t>( 2 * cosine);
+    }
+
+    /// squared magnitude of a band, divided by 4 to stay within 32 bits.
+    int32_t power( uint8_t band) const
+    {
+        const int32_t a = s1[band] >> 1;
+        const int32_t b = s2[band] >> 1;
+        return a * a + b * b - ((coefficients[band] * a) >> 13) * b;
+    }
+
+    /// add a correction to a level, keeping silence at zero and saturating at 255.
+    static uint8_t corrected( uint8_t level, uint8_t correction)
+    {
+        if (!level) return 0;
+        const uint16_t result = level + correction;
+        return result > 255 ? 255 : result;
+    }
+
+    /// 8 x log2( power), from the position of the highest bit and the 3 bits below it.
+    static uint8_t log_level( int32_t power)
+    {
+        if (power <= 0) return 0;
+        uint32_t value = power;
+        uint8_t result = 31 * 8;
+        while (!(value & 0x80000000UL))
+        {
+            value <<= 1;
+            result -= 8;
+        }
+        return result + ((value >> 28) & 0x07);
+    }
+
+    int16_t     coefficients[band_count];
+    int16_t     s1[band_count];
+    int16_t     s2[band_count];
+    uint16_t    phases[band_count];
+    uint16_t    phase_steps[band_count];
+    uint8_t     lengths[band_count];
+    uint8_t     positions[band_count];
+    uint8_t     corrections[band_count];
+    uint8_t     peaks[band_count];
+    uint8_t     levels[band_count];
+    uint8_t     offset;
+    uint16_t    sum;
+    uint8_t     samples;
+};
+
+}
+
+#endif /* BAND_ANALYSER_HPP_ */
@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * A free-running time base, based on a 16-bit hardware timer.
+ *
+ * A clock type has a static now() function that returns the current time in ticks and a
+ * constant ticks_per_ms. Times are 16-bit values that wrap around, so time differences should
+ * always be calculated as an unsigned 16-bit subtraction.
+ *
+ * If the macro WS2811_IDLE_CLOCK is defined as the name of a clock type, run_effect() and the scheduler
+ * wait for the next frame in the idle sleep mode instead of in a busy loop, see sleep_until() below. E.g.:
+ *
+ * #define WS2811_IDLE_CLOCK ws2811::timer1_clock
+ * ...
+ * EMPTY_INTERRUPT( TIMER1_COMPA_vect);
+ * ...
+ * ws2811::timer1_clock::init();
+ *
+ * The Timer1 compare match A interrupt wakes the controller. Like the USART and ADC interrupt handlers,
+ * its handler is defined by the application; it only has to exist, so EMPTY_INTERRUPT() will do.
+ * Interrupts are enabled globally while sleeping, so other interrupt handlers may run between frames.
+ */
+
+#ifndef CLOCK_HPP_
+#define CLOCK_HPP_
+#include <avr/io.h>
+
+#if defined( WS2811_IDLE_CLOCK)
+#   include <avr/interrupt.h>
+#   include <avr/sleep.h>
+#endif
+
+namespace ws2811
+{
+
+/**
+ * Clock based on Timer1, running at F_CPU/64.
+ *
+ * At 8Mhz this gives ticks of 8us, wrapping around after 524ms.
+ * Devices without a Timer1 (e.g. the attiny13) cannot use this clock.
+ *
+ * Reading TCNT1 is only atomic if no interrupt handler accesses any of the 16-bit
+ * timer registers.
+ */
+struct timer1_clock
+{
+    static const uint16_t ticks_per_ms = F_CPU / 64 / 1000;
+
+    /// start the timer in normal mode, with a prescaler of 64.
+    static void init()
+    {
+        TCCR1A = 0;
+        TCCR1B = _BV( CS11) | _BV( CS10);
+    }
+
+    static uint16_t now()
+    {
+        return TCNT1;
+    }
+
+#if defined( WS2811_IDLE_CLOCK)
+    /**
+     * Sleep in idle mode until the clock has reached the deadline.
+     *
+     * The compare match A interrupt wakes the CPU at the deadline. Other interrupts may wake it earlier,
+     * in which case it goes back to sleep. Interrupts are disabled between checking the time and
+     * sleeping, so a deadline that passes in between still wakes the CPU immediately.
+     * The deadline must be less than half the wrap-around time ahead, 262ms at 8Mhz.
+     *
+     * Idle mode stops the CPU clock but keeps the timers running. The deeper sleep modes would
+     * stop Timer1 as well. Estimated savings, from the typical figures of the atmega328p datasheet
+     * at 8Mhz and 5V: about 4mA when running and about 1.2mA when idle. An effect that spends
+     * 2ms of every 20ms frame on rendering and sending then draws about 1.5mA on average.
+     * That is small next to the LEDs, but it matters for battery-powered strings that are mostly dark.
+     *
+     * Wake-up from idle takes no oscillator start-up time, only the 8 cycles of the interrupt response
+     * plus the empty interrupt handler and the time check. Together that is about 30 cycles, or 4us at 8Mhz.
+     * This is less than one 8us tick, so frames start within one tick of their deadline.
+     */
+    static void sleep_until( uint16_t deadline)
+    {
+        const uint8_t status = SREG;
+        set_sleep_mode( SLEEP_MODE_IDLE);
+        cli();
+        OCR1A = deadline;
+        TIFR1 = _BV( OCF1A);
+        TIMSK1 |= _BV( OCIE1A);
+        while (static_cast<int16_t>( now() - deadline) < 0)
+        {
+            sleep_enable();
+            sei();      // the instruction after sei() is always executed before any interrupt handler.
+            sleep_cpu();
+            sleep_disable();
+            cli();
+        }
+        TIMSK1 &= ~_BV( OCIE1A);
+        SREG = status;
+    }
+#endif
+};
+
+}
+
+#endif /* CLOCK_HPP_ */
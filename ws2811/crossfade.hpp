@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Smooth crossfades between two LED frames.
+ *
+ * When a fade starts, the difference between the current and the target value of every color channel
+ * is divided by the number of steps, once. Every step then only adds this 8.8 fixed point delta to
+ * the channel, there is no multiplication or division per pixel per frame. The last step copies the
+ * target frame, so that rounding errors never accumulate over several fades.
+ *
+ * Target frames can be stored in RAM (start()) or in flash (start_P()).
+ *
+ * The price is RAM: a fraction byte and a 16-bit delta per color channel, which is 9 bytes per LED on top of
+ * the LED buffer itself. A step costs about 20 cycles per channel, 60 per LED: roughly 1ms for a 144 LED
+ * string at 8Mhz.
+ */
+
+#ifndef CROSSFADE_HPP_
+#define CROSSFADE_HPP_
+#include <avr/pgmspace.h>
+#include "rgb.h"
+
+namespace ws2811
+{
+
+template< uint16_t led_count>
+class crossfade
+{
+public:
+    crossfade()
+    :target( 0), target_in_flash( false), remaining( 0)
+    {}
+
+    /**
+     * Start a fade from the current contents of leds to a target frame in RAM.
+     * The target must remain valid until the fade is done.
+     */
+    void start( const rgb (&leds)[led_count], const rgb (&target_frame)[led_count], uint16_t steps)
+    {
+        target = reinterpret_cast<const uint8_t *>( target_frame);
+        target_in_flash = false;
+        prepare( leds, steps);
+    }
+
+    /**
+     * Start a fade from the current contents of leds to a target frame in flash memory.
+     */
+    void start_P( const rgb (&leds)[led_count], const rgb *target_frame, uint16_t steps)
+    {
+        target = reinterpret_cast<const uint8_t *>( target_frame);
+        target_in_flash = true;
+        prepare( leds, steps);
+    }
+
+    /// true if the last fade has reached its target.
+    bool done() const
+    {
+        return !remaining;
+    }
+
+    /**
+     * Move the leds one step closer to the target. The leds should not have been changed
+     * by anything else since the fade was started.
+     */
+    void step( rgb (&leds)[led_count])
+    {
+        if (!remaining) return;
+
+        uint8_t *values = reinterpret_cast<uint8_t *>( leds);
+        if (!--remaining)
+        {
+            for (uint16_t idx = 0; idx < channel_count; ++idx)
+            {
+                values[idx] = target_value( idx);
+            }
+            return;
+        }
+
+        for (uint16_t idx = 0; idx < channel_count; ++idx)
+        {
+            const uint16_t accumulator = ((static_cast<uint16_t>( values[idx]) << 8) | fractions[idx]) + deltas[idx];
+            values[idx] = accumulator >> 8;
+            fractions[idx] = accumulator;
+        }
+    }
+
+private:
+    static const uint16_t channel_count = led_count * sizeof( rgb);
+
+    uint8_t target_value( uint16_t index) const
+    {
+        return target_in_flash ? pgm_read_byte( target + index) : target[index];
+    }
+
+    void prepare( const rgb (&leds)[led_count], uint16_t steps)
+    {
+        // one step means: jump to the target.
+        remaining = steps ? steps : 1;
+        if (remaining < 2) return;
+
+        // with at least two steps, the deltas fit in a signed 8.8 number.
+        const uint16_t reciprocal = 0xffff / remaining;
+        const uint8_t *values = reinterpret_cast<const uint8_t *>( leds);
+        for (uint16_t idx = 0; idx < channel_count; ++idx)
+        {
+            const int16_t difference = static_cast<int16_t>( target_value( idx)) - values[idx];
+            // round towards zero, so that the channel never overshoots the target and wraps around.
+            const int32_t delta = static_cast<int32_t>( difference < 0 ? -difference : difference) * reciprocal >> 8;
+            deltas[idx] = difference < 0 ? -delta : delta;
+            fractions[idx] = 0x80;
+        }
+    }
+
+    const uint8_t   *target;
+    bool            target_in_flash;
+    uint16_t        remaining;
+    uint8_t         fractions[channel_count];
+    int16_t         deltas[channel_count];
+};
+
+}
+
+#endif /* CROSSFADE_HPP_ */
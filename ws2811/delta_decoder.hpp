@@ -0,0 +1,215 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Decoder for a compact frame-delta protocol.
+ *
+ * Sending full frames costs 3 bytes per LED per frame. This protocol only describes how
+ * a frame differs from the previous one and the decoder applies those differences in place to
+ * an existing rgb buffer.
+ *
+ * A frame starts with the three bytes 'D', 'e', 'l', followed by a sequence of opcodes and ends
+ * with the opcode 0xff. Each frame starts at LED 0. Opcodes are:
+ *
+ * 00nnnnnn                 skip n+1 LEDs, leaving them unchanged
+ * 01nnnnnn R G B ...       n+1 literal LED values follow, 3 bytes each
+ * 10nnnnnn i i ...         n+1 LEDs get a color from the palette. The palette indices follow, packed
+ *                          two per byte, high nibble first. An odd count leaves the low nibble of the last byte unused.
+ * 110nnnnn R G B           n+1 LEDs all get the given color
+ * 1110nnnn s R G B ...     define n+1 palette entries, starting at palette entry s (0-15)
+ * 11110000 - 11111110      reserved
+ * 11111111                 end of frame
+ *
+ * Colors are always sent in R, G, B order, independent of the in-memory order of the rgb struct.
+ * The palette is retained between frames. LEDs beyond the end of the buffer are ignored.
+ *
+ * The tool tools/delta_encoder.cpp creates streams in this format from raw frames, tools/animation_encoder.cpp
+ * creates animations for flash_animation.hpp from image sequences.
+ *
+ * Average bytes per frame for the effects in this project, rendered for a 60 LED string
+ * (a full Adalight frame is 186 bytes):
+ *  - chasers       135
+ *  - campfire       45
+ *  - flares         44
+ *  - water torture  10
+ */
+
+#ifndef DELTA_DECODER_HPP_
+#define DELTA_DECODER_HPP_
+#include "rgb.h"
+
+namespace ws2811
+{
+
+/**
+ * Byte-by-byte decoder for the frame-delta protocol.
+ *
+ * Bytes are fed to the receive() function, which can be called from a USART receive interrupt
+ * or from a main loop. The decoder writes directly into the buffer that was given to its
+ * constructor. Note that this means that the buffer should not be sent while a frame is
+ * being decoded into it.
+ */
+template< uint16_t led_count>
+class delta_decoder
+{
+public:
+    static const uint8_t palette_size = 16;
+    static const uint8_t end_of_frame = 0xff;
+
+    explicit delta_decoder( rgb (&leds)[led_count])
+    :leds( leds), state( header_d), position(0), count(0), channel(0)
+    {}
+
+    /**
+     * Process one byte of the stream.
+     * Returns true if this byte completed a frame.
+     */
+    bool receive( uint8_t byte)
+    {
+        switch (state)
+        {
+        case header_d:
+            if (byte == 'D') state = header_e;
+            break;
+        case header_e:
+            state = (byte == 'e')?header_l:header_d;
+            break;
+        case header_l:
+            if (byte == 'l')
+            {
+                position = 0;
+                state = opcode;
+            }
+            else
+            {
+                state = header_d;
+            }
+            break;
+        case opcode:
+            return decode_opcode( byte);
+        case literal:
+            if (add_channel( byte))
+            {
+                write( current);
+                if (!--count) state = opcode;
+            }
+            break;
+        case repeat:
+            if (add_channel( byte))
+            {
+                while (count--) write( current);
+                state = opcode;
+            }
+            break;
+        case palette_indices:
+            write( palette[byte >> 4]);
+            if (--count)
+            {
+                write( palette[byte & 0x0f]);
+                --count;
+            }
+            if (!count) state = opcode;
+            break;
+        case palette_start:
+            palette_entry = byte & 0x0f;
+            state = palette_colors;
+            break;
+        case palette_colors:
+            if (add_channel( byte))
+            {
+                palette[palette_entry] = current;
+                palette_entry = (palette_entry + 1) & 0x0f;
+                if (!--count) state = opcode;
+            }
+            break;
+        }
+        return false;
+    }
+
+    rgb palette[palette_size];
+
+private:
+    enum stateval {
+        header_d,
+        header_e,
+        header_l,
+        opcode,
+        literal,
+        repeat,
+        palette_indices,
+        palette_start,
+        palette_colors
+    };
+
+    bool decode_opcode( uint8_t byte)
+    {
+        if (byte == end_of_frame)
+        {
+            state = header_d;
+            return true;
+        }
+
+        count = (byte & 0x3f) + 1;
+        channel = 0;
+        switch (byte >> 6)
+        {
+        case 0:
+            position += count;
+            break;
+        case 1:
+            state = literal;
+            break;
+        case 2:
+            state = palette_indices;
+            break;
+        default:
+            if (byte < 0xe0)
+            {
+                count = (byte & 0x1f) + 1;
+                state = repeat;
+            }
+            else if (byte < 0xf0)
+            {
+                count = (byte & 0x0f) + 1;
+                state = palette_start;
+            }
+            break;
+        }
+        return false;
+    }
+
+    /// add a byte to the 'current' color. Returns true if all three channels have been received.
+    bool add_channel( uint8_t byte)
+    {
+        static const uint8_t offsets[] = { rgb::red_offset, rgb::green_offset, rgb::blue_offset};
+        reinterpret_cast<uint8_t *>( &current)[offsets[channel]] = byte;
+        if (++channel == 3)
+        {
+            channel = 0;
+            return true;
+        }
+        return false;
+    }
+
+    /// write a color to the current position and advance one position.
+    void write( const rgb &color)
+    {
+        if (position < led_count) leds[position] = color;
+        ++position;
+    }
+
+    rgb         (&leds)[led_count];
+    stateval    state;
+    uint16_t    position;
+    uint8_t     count;
+    uint8_t     channel;
+    uint8_t     palette_entry;
+    rgb         current;
+};
+
+}
+#endif /* DELTA_DECODER_HPP_ */
@@ -0,0 +1,228 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Temporal dithering for smooth fades at low intensities.
+ *
+ * With 8 bits per channel, the step from intensity 1 to 2 doubles the light output, so slow fades
+ * towards black visibly jump between levels. A hires_leds buffer stores each channel as an 8.8 fixed
+ * point value. When the buffer is sent, the fraction decides how often the channel is rounded up:
+ * a channel at 2.25 shows 3 in one frame out of four and 2 in the others. At frame rates of 100 fps and
+ * higher the eye averages these frames into the intermediate level.
+ *
+ * Rounding up happens when the fraction exceeds a threshold that runs through a 16-step bit-reversed
+ * sequence, so that rounding up is spread evenly over the frames instead of happening in bursts.
+ * Each LED starts at a different point in the sequence, so neighboring LEDs do not flicker in step.
+ * Fractions are effectively 4 bits: a full cycle takes 16 frames, which at 100 fps means that the lowest
+ * fractions blink at about 6Hz.
+ *
+ * Cost: 6 bytes of RAM per LED, twice that of a rgb array, plus one frame counter. Dithering is done while
+ * sending, one LED at a time, and takes about 50 clock ticks per LED, which keeps the data line low for about
+ * 6us between LEDs (at 8Mhz). This is well below the reset time of the controllers. A 100 LED string takes
+ * about 3.5ms to send.
+ *
+ * The dithering sequence only advances when the buffer is sent, so the buffer must be sent at 100 fps or
+ * more, also when the effect itself runs at a lower frame rate or does not change at all. run_dithered()
+ * does this: it lets the effect step every frame_ms, but sends the buffer every refresh_ms.
+ *
+ * Effects write to the buffer through get( leds, index) = value, set() and set_scaled(); set_scaled() keeps
+ * the bits that an 8-bit buffer would drop when scaling a color by an amplitude.
+ */
+
+#ifndef DITHER_HPP_
+#define DITHER_HPP_
+#include <avr/pgmspace.h>
+#include "ws2811.h"
+#include "effect.hpp"
+
+namespace ws2811
+{
+
+template< uint16_t led_count>
+struct hires_leds
+{
+    hires_leds()
+    :frame( 0)
+    {
+        memset( (void *)buffer, 0, sizeof buffer);
+    }
+
+    uint16_t    buffer[3 * led_count]; ///< 8.8 values, in the memory order of rgb
+    uint8_t     frame;
+};
+
+template< uint16_t led_count>
+struct led_buffer_traits<hires_leds<led_count> >
+{
+    static const uint16_t count = led_count;
+    static const uint16_t size = 3 * sizeof( uint16_t) * led_count;
+};
+
+namespace detail {
+/// bit-reversed sequence of thresholds, centered in each 1/16th step.
+static const uint8_t dither_thresholds[] PROGMEM = {
+        8, 136, 72, 200, 40, 168, 104, 232, 24, 152, 88, 216, 56, 184, 120, 248
+};
+
+inline uint8_t dither( uint16_t value, uint8_t threshold)
+{
+    const uint8_t whole = value >> 8;
+    return (static_cast<uint8_t>( value) > threshold && whole != 255) ? whole + 1 : whole;
+}
+}
+
+namespace detail {
+inline rgb hires_value( const uint16_t *channels)
+{
+    rgb result;
+    uint8_t *bytes = reinterpret_cast<uint8_t *>( &result);
+    bytes[0] = channels[0] >> 8;
+    bytes[1] = channels[1] >> 8;
+    bytes[2] = channels[2] >> 8;
+    return result;
+}
+}
+
+/**
+ * Stands in for an rgb reference to an LED in a hires buffer, so that effects that write
+ * get( leds, index) = value work unchanged. Reading gives the value rounded down to 8 bits,
+ * assigning stores the value with a zero fraction.
+ * Functions that take an rgb reference, such as add_clipped(), do not accept it.
+ */
+class hires_reference
+{
+public:
+    explicit hires_reference( uint16_t *channels)
+    :channels( channels)
+    {}
+
+    operator rgb() const
+    {
+        return detail::hires_value( channels);
+    }
+
+    hires_reference &operator=( const rgb &value)
+    {
+        channels[rgb::red_offset] = static_cast<uint16_t>( value.red) << 8;
+        channels[rgb::green_offset] = static_cast<uint16_t>( value.green) << 8;
+        channels[rgb::blue_offset] = static_cast<uint16_t>( value.blue) << 8;
+        return *this;
+    }
+
+    hires_reference &operator=( const hires_reference &other)
+    {
+        return *this = static_cast<rgb>( other);
+    }
+
+private:
+    uint16_t *channels;
+};
+
+/**
+ * Get the value of an LED, rounded down to 8 bits.
+ */
+template< uint16_t led_count>
+inline rgb get( const hires_leds<led_count> &leds, uint16_t index)
+{
+    return detail::hires_value( &leds.buffer[3 * index]);
+}
+
+template< uint16_t led_count>
+inline hires_reference get( hires_leds<led_count> &leds, uint16_t index)
+{
+    return hires_reference( &leds.buffer[3 * index]);
+}
+
+template< uint16_t led_count>
+inline void set( hires_leds<led_count> &leds, uint16_t index, const rgb &value)
+{
+    get( leds, index) = value;
+}
+
+/**
+ * Set an LED to offset + color x amplitude / 256, keeping the fraction.
+ * Like the rgb array version, this does not clip.
+ */
+template< uint16_t led_count>
+inline void set_scaled( hires_leds<led_count> &leds, uint16_t index, const rgb &color, uint8_t amplitude, const rgb &offset = rgb())
+{
+    uint16_t *channels = &leds.buffer[3 * index];
+    channels[rgb::red_offset] = (static_cast<uint16_t>( offset.red) << 8) + static_cast<uint16_t>( color.red) * amplitude;
+    channels[rgb::green_offset] = (static_cast<uint16_t>( offset.green) << 8) + static_cast<uint16_t>( color.green) * amplitude;
+    channels[rgb::blue_offset] = (static_cast<uint16_t>( offset.blue) << 8) + static_cast<uint16_t>( color.blue) * amplitude;
+}
+
+template< uint16_t led_count>
+inline void clear( hires_leds<led_count> &leds)
+{
+    memset( (void *)leds.buffer, 0, sizeof leds.buffer);
+}
+
+template< uint16_t led_count>
+inline void fill( hires_leds<led_count> &leds, const rgb &value)
+{
+    for (uint16_t index = 0; index < led_count; ++index)
+    {
+        set( leds, index, value);
+    }
+}
+
+/**
+ * Send a hires buffer, dithering each LED to 8 bits just before it is sent.
+ * Every call advances the buffer to the next frame of the dithering sequence.
+ */
+template< uint16_t led_count>
+void send( hires_leds<led_count> &leds, uint8_t bit)
+{
+    const uint8_t mask = _BV( bit);
+    const uint16_t *channels = leds.buffer;
+    uint8_t phase = leds.frame++;
+
+    detail::reset( bit);
+    for (uint16_t index = 0; index < led_count; ++index)
+    {
+        const uint8_t threshold = pgm_read_byte( &detail::dither_thresholds[phase & 0x0f]);
+        uint8_t bytes[3];
+        bytes[0] = detail::dither( channels[0], threshold);
+        bytes[1] = detail::dither( channels[1], threshold);
+        bytes[2] = detail::dither( channels[2], threshold);
+        detail::send_bytes( bytes, sizeof bytes, mask);
+        channels += 3;
+        phase += 5;
+    }
+    detail::end_frame( bit);
+}
+
+/**
+ * Run an effect on a hires buffer, forever.
+ *
+ * The effect steps every frame_ms and renders when it reports a change, like with run_effect(). The buffer
+ * is sent every refresh_ms, whether it changed or not, so that the dithering keeps running at
+ * 1000 / refresh_ms frames per second. Without WS2811_IDLE_CLOCK (see clock.hpp), the time to render
+ * and send comes on top of refresh_ms.
+ */
+template< typename effect_type, uint16_t led_count>
+void run_dithered( effect_type &effect, hires_leds<led_count> &leds, uint8_t channel, uint8_t refresh_ms = 5)
+{
+    frame_timer timer;
+    uint8_t elapsed = effect_type::frame_ms;
+    for (;;)
+    {
+        if (elapsed >= effect_type::frame_ms)
+        {
+            elapsed = 0;
+            if (effect.step()) effect.render( leds);
+        }
+        send( leds, channel);
+        timer.wait( refresh_ms);
+        elapsed += refresh_ms;
+    }
+}
+
+}
+
+#endif /* DITHER_HPP_ */
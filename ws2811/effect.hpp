@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * The interface that all effects implement.
+ *
+ * An effect is a class template, parameterized on the LED buffer type, with the following members:
+ * - static const uint8_t frame_ms, the intended time between two frames in milliseconds,
+ * - bool step(), which calculates the next state of the animation without touching any LED buffer
+ *   and returns true if the next call to render() would draw something different than the last one,
+ * - void render( buffer_type &leds), which draws the current state into a LED buffer.
+ *
+ * Effects only access the buffer through get(), clear() and similar functions and take the
+ * LED count from led_buffer_traits<buffer_type>::count, so that they work for every buffer type
+ * that supports those.
+ *
+ * Because state updates and drawing are separated, callers can run several effects from one loop
+ * (see scheduler.hpp), time both phases independently, run several steps for every render or
+ * skip rendering and sending when nothing changed.
+ *
+ * Both run_effect() and the scheduler can measure the duration of both phases, see profile.hpp, and
+ * both can sleep between frames, see clock.hpp.
+ */
+
+#ifndef EFFECT_HPP_
+#define EFFECT_HPP_
+#include <util/delay.h>
+#include "ws2811.h"
+#include "profile.hpp"
+
+#if defined( WS2811_IDLE_CLOCK)
+#   include "clock.hpp"
+#endif
+
+namespace ws2811
+{
+
+#if defined( WS2811_IDLE_CLOCK)
+/**
+ * Starts frames at fixed intervals and sleeps until the next one is due.
+ * Intervals are counted from the previous deadline, so time spent on a frame does not add up.
+ * If a frame took longer than a whole interval, the next frame starts immediately and
+ * intervals are counted from there, instead of trying to catch up.
+ */
+class frame_timer
+{
+public:
+    frame_timer()
+    :deadline( WS2811_IDLE_CLOCK::now())
+    {}
+
+    void wait( uint8_t ms)
+    {
+        deadline += static_cast<uint16_t>( ms) * WS2811_IDLE_CLOCK::ticks_per_ms;
+        const uint16_t now = WS2811_IDLE_CLOCK::now();
+        if (static_cast<int16_t>( now - deadline) > 0)
+        {
+            // we're more than one interval late, don't let the lag build up.
+            deadline = now;
+        }
+        WS2811_IDLE_CLOCK::sleep_until( deadline);
+    }
+
+private:
+    uint16_t deadline;
+};
+#else
+/// without an idle clock, frame_ms is waited out after each frame.
+class frame_timer
+{
+public:
+    void wait( uint8_t ms)
+    {
+        while (ms--) _delay_ms( 1);
+    }
+};
+#endif
+
+/**
+ * Run an effect on a single LED string, forever.
+ * Frames are only rendered and sent if the effect reports a change.
+ *
+ * If WS2811_IDLE_CLOCK is defined, frames start every frame_ms, independent of the time spent on rendering
+ * and sending, and the controller sleeps in between. Otherwise, frame_ms is waited out after each frame.
+ */
+template< typename effect_type, typename buffer_type>
+void run_effect( effect_type &effect, buffer_type &leds, uint8_t channel)
+{
+    frame_timer timer;
+    for (;;)
+    {
+        if (effect.step())
+        {
+            detail::frame_stopwatch stopwatch;
+            effect.render( leds);
+            stopwatch.rendered( channel);
+            send( leds, channel);
+            stopwatch.sent( channel);
+        }
+        timer.wait( effect_type::frame_ms);
+    }
+}
+
+}
+
+#endif /* EFFECT_HPP_ */
@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Dim all LEDs in a buffer, in place.
+ *
+ * Effects that leave trails, like the chasers, can fade the buffer a little every frame and draw only the
+ * heads of their objects, instead of clearing the buffer and drawing every pixel of every trail.
+ *
+ * The factor has the same meaning as in detail::scale8(): 255 leaves the values unchanged, 0 clears them
+ * and each value v becomes v * (factor + 1) / 256.
+ *
+ * On devices with a hardware multiplier, fading takes 12 cycles per byte, or 36 cycles per LED. That
+ * is less than 1ms for a 144 LED string at 8Mhz. On devices without (e.g. attiny13) it uses the shift-and-add
+ * loop of scale8(), which is about 5 times slower.
+ */
+
+#ifndef FADE_HPP_
+#define FADE_HPP_
+#include "ws2811.h"
+#include "rgb_operators.hpp"
+
+namespace ws2811
+{
+namespace detail {
+
+/**
+ * Scale 'size' consecutive bytes with factor.
+ * size must be at least 1.
+ */
+inline void fade_bytes( uint8_t *values, uint16_t size, uint8_t factor)
+{
+#ifdef __AVR_HAVE_MUL__
+    uint8_t value;
+    asm volatile(
+            "fade%=: LD %[value], %a[dataptr]                \n"
+            "        MUL %[value], %[factor]                 \n" // r1:r0 = value * factor
+            "        ADD r0, %[value]                        \n" // add value once more, to multiply by (factor + 1)
+            "        ADC r1, %[zero]                         \n"
+            "        ST %a[dataptr]+, r1                     \n" // store the high byte
+            "        SBIW %[size], 1                         \n"
+            "        BRNE fade%=                             \n"
+            "        CLR __zero_reg__                        \n"
+    : /* outputs */
+    [dataptr] "+e" (values),
+    [size]    "+w" (size),
+    [value]   "=&r" (value)
+    : /* inputs */
+    [factor]  "r" (factor),
+    [zero]    "r" (static_cast<uint8_t>( 0))
+    : "r0", "memory"
+    );
+#else
+    while (size--)
+    {
+        *values = scale8( *values, factor);
+        ++values;
+    }
+#endif
+}
+}
+
+template< uint16_t led_count>
+inline void fade( rgb (&leds)[led_count], uint8_t factor)
+{
+    detail::fade_bytes( reinterpret_cast<uint8_t *>( leds), sizeof leds, factor);
+}
+
+/**
+ * Fade the LEDs of any buffer that gives access to its LEDs through get(), one LED at a time.
+ */
+template< typename buffer_type>
+inline void fade( buffer_type &leds, uint8_t factor)
+{
+    for (uint16_t index = 0; index < led_buffer_traits<buffer_type>::count; ++index)
+    {
+        const rgb value = get( leds, index);
+        get( leds, index) = rgb(
+                detail::scale8( value.red, factor),
+                detail::scale8( value.green, factor),
+                detail::scale8( value.blue, factor));
+    }
+}
+
+#if defined( WS2811_96_H_)
+/**
+ * Fade the LEDs that are stored in a sparse buffer.
+ * Stored LEDs that fade to black are not removed from the buffer, compact() removes them.
+ */
+template< uint8_t buffer_size, uint8_t led_string_size>
+inline void fade( sparse_leds<buffer_size, led_string_size> &leds, uint8_t factor)
+{
+    uint8_t *block = &leds.buffer[0];
+    uint8_t * const end = block + buffer_size;
+
+    // each block is a jump, a count and count rgb values. A count of zero ends the buffer.
+    while (block + 1 < end && block[1])
+    {
+        const uint8_t bytes = 3 * block[1];
+        detail::fade_bytes( block + 2, bytes, factor);
+        block += 2 + bytes;
+    }
+}
+#endif
+
+}
+
+#endif /* FADE_HPP_ */
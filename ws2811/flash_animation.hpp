@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Playback of compressed animations that are stored in flash memory.
+ *
+ * Animations are stored in the frame-delta format of delta_decoder.hpp: each frame only describes
+ * the LEDs that changed since the previous frame, using run lengths, a 16-color palette and literal colors.
+ * The tool tools/animation_encoder.cpp converts a sequence of images into a C++ header with the animation data.
+ *
+ * Frames are decoded directly into the LED buffer, one byte at a time, so no RAM is needed beyond the buffer and
+ * the decoder state (about 60 bytes, mostly the palette). Decoding costs roughly 40 cycles per stream byte, which means
+ * that a typical frame of 50 bytes takes about 0.25ms at 8Mhz. Decoding inside the send loop
+ * is not possible: there are only a few spare cycles per bit.
+ */
+
+#ifndef FLASH_ANIMATION_HPP_
+#define FLASH_ANIMATION_HPP_
+#include <avr/pgmspace.h>
+#include "ws2811.h"
+#include "effect.hpp"
+#include "delta_decoder.hpp"
+
+namespace ws2811
+{
+
+template< uint16_t led_count>
+class flash_animation
+{
+public:
+    /// data points to 'size' bytes of frame-delta stream in flash.
+    flash_animation( rgb (&leds)[led_count], const uint8_t *data, uint16_t size)
+    :leds( leds), decoder( leds), data( data), size( size), position( 0)
+    {
+        clear( leds);
+    }
+
+    /**
+     * Decode the next frame into the led buffer.
+     * After the last frame, the animation starts again with a black buffer.
+     * Returns false if the data did not contain a complete frame.
+     */
+    bool next_frame()
+    {
+        for (uint16_t count = 0; count < size; ++count)
+        {
+            if (position >= size)
+            {
+                // the encoder assumes that the first frame starts from a black string.
+                position = 0;
+                clear( leds);
+            }
+            if (decoder.receive( pgm_read_byte( data + position++)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    rgb                         (&leds)[led_count];
+    delta_decoder<led_count>    decoder;
+    const uint8_t               *data;
+    uint16_t                    size;
+    uint16_t                    position;
+};
+
+/**
+ * Play an animation from flash on the given channel, forever.
+ */
+template< uint16_t led_count>
+void play( rgb (&leds)[led_count], const uint8_t *data, uint16_t size, uint8_t channel, uint8_t frame_ms)
+{
+    flash_animation<led_count> animation( leds, data, size);
+    frame_timer timer;
+    while (animation.next_frame())
+    {
+        send( leds, channel);
+        timer.wait( frame_ms);
+    }
+}
+
+}
+
+#endif /* FLASH_ANIMATION_HPP_ */
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Interpolation between input frames that arrive at a lower rate than the string can be refreshed.
+ *
+ * Frames that are streamed by a host or decoded from a stored animation typically arrive at 25-30 fps,
+ * which makes motion look choppy. A frame_interpolator keeps the output buffer separate from the input
+ * frame and moves the output towards the latest input in a number of smaller steps, using the
+ * fixed-point deltas of crossfade.hpp. A new input frame can arrive at any time: the output then starts
+ * moving from wherever it is towards the new frame, so there is never a jump.
+ *
+ * The input frame must not change while the output is moving towards it, which is the case for the
+ * front buffer of a frame_receiver (see usart_receiver.hpp) until the next swap():
+ *
+ *     if (receiver.frame_ready())
+ *     {
+ *         receiver.swap();
+ *         interpolator.next_input( leds, receiver.front_buffer());
+ *     }
+ *     if (interpolator.step( leds)) send( leds, channel);
+ *
+ * Estimated cost at 8Mhz, per output frame and per new input frame, compared to the time needed to send
+ * the frame:
+ *
+ *     LEDs   step()    next_input()   send()    max. output rate
+ *      30    0.23ms    0.9ms          0.9ms     ~880 fps
+ *      60    0.45ms    1.9ms          1.8ms     ~440 fps
+ *     144    1.1ms     4.5ms          4.3ms     ~185 fps
+ *
+ * A step costs about 60 clock ticks per LED. Starting the interpolation towards a new frame costs a 32-bit
+ * multiplication per channel, about 250 clock ticks per LED, but only once per input frame.
+ * RAM use is 9 bytes per LED for the interpolation state, on top of the output and input buffers.
+ */
+
+#ifndef INTERPOLATOR_HPP_
+#define INTERPOLATOR_HPP_
+#include "ws2811.h"
+#include "effect.hpp"
+#include "crossfade.hpp"
+#include "flash_animation.hpp"
+
+namespace ws2811
+{
+
+template< uint16_t led_count>
+class frame_interpolator
+{
+public:
+    /// steps is the number of output frames that it takes to reach an input frame.
+    explicit frame_interpolator( uint8_t steps)
+    :steps( steps)
+    {}
+
+    /**
+     * Start moving the output from its current contents towards a new input frame.
+     * The input must not change until the output has reached it or until the next call to next_input().
+     */
+    void next_input( const rgb (&output)[led_count], const rgb (&input)[led_count])
+    {
+        fade.start( output, input, steps);
+    }
+
+    /**
+     * Calculate the next output frame.
+     * Returns false if the output had already reached the last input frame and did not change.
+     */
+    bool step( rgb (&output)[led_count])
+    {
+        if (fade.done()) return false;
+        fade.step( output);
+        return true;
+    }
+
+private:
+    crossfade<led_count>    fade;
+    uint8_t                 steps;
+};
+
+/**
+ * Play an animation from flash on the given channel, forever, with 'steps' interpolated output frames
+ * per animation frame. frame_ms is the time between two animation frames.
+ *
+ * This needs RAM for a second frame (the decoded input), next to the interpolation state.
+ * Zero steps behave like one: each animation frame is shown as is.
+ */
+template< uint16_t led_count>
+void play_interpolated( rgb (&leds)[led_count], const uint8_t *data, uint16_t size, uint8_t channel, uint8_t frame_ms, uint8_t steps)
+{
+    rgb input[led_count];
+    flash_animation<led_count> animation( input, data, size);
+    frame_interpolator<led_count> interpolator( steps);
+    const uint8_t step_ms = steps ? frame_ms / steps : frame_ms;
+    frame_timer timer;
+
+    clear( leds);
+    while (animation.next_frame())
+    {
+        interpolator.next_input( leds, input);
+        while (interpolator.step( leds))
+        {
+            send( leds, channel);
+            timer.wait( step_ms);
+        }
+    }
+}
+
+}
+
+#endif /* INTERPOLATOR_HPP_ */
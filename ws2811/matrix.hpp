@@ -0,0 +1,260 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Two-dimensional access to LED panels.
+ *
+ * A matrix wraps a regular rgb array and maps (x, y) coordinates to positions in that array according to
+ * the way the panel is wired. The wiring is selected at compile time with a layout type:
+ * - row_major:     rows run left to right, one after the other.
+ * - serpentine:    even rows run left to right, odd rows run right to left.
+ * - column_major:  columns run top to bottom, one after the other.
+ * - table_layout:  any other wiring, described by a table in program memory.
+ *
+ * Because the layout is a template argument, index calculations are inlined and constant factors
+ * are folded by the compiler. For example:
+ *
+ *     rgb leds[16 * 8];
+ *     matrix< serpentine<16, 8> > panel( leds);
+ *     get( panel, x, y) = rgb( 10, 0, 0);
+ *     write_row( panel, 0, 3, line, 16);
+ *     send( panel, channel);
+ *
+ * write_row() and write_column() copy a line of pixels with a pointer that steps through the array,
+ * if the layout has a constant distance between neighboring pixels on that line. Only table layouts fall back
+ * to looking up every pixel.
+ *
+ * A matrix is also a regular one-dimensional buffer: get( panel, index), clear(), fill() and send() work
+ * on the underlying array, in wiring order.
+ */
+
+#ifndef MATRIX_HPP_
+#define MATRIX_HPP_
+#include <avr/pgmspace.h>
+#include "ws2811.h"
+
+namespace ws2811
+{
+
+/**
+ * Rows run from left to right and follow each other from top to bottom.
+ */
+template< uint8_t columns, uint8_t rows>
+struct row_major
+{
+    static const uint8_t width = columns;
+    static const uint8_t height = rows;
+
+    static uint16_t index( uint8_t x, uint8_t y)
+    {
+        return static_cast<uint16_t>( y) * width + x;
+    }
+
+    /// distance in the array between (x, y) and (x + 1, y), or zero if that distance depends on x.
+    static int16_t row_step( uint8_t)
+    {
+        return 1;
+    }
+
+    /// distance in the array between (x, y) and (x, y + 1), or zero if that distance depends on y.
+    static int16_t column_step( uint8_t)
+    {
+        return width;
+    }
+};
+
+/**
+ * Rows follow each other from top to bottom. The first row runs from left to right,
+ * the second from right to left, and so on.
+ */
+template< uint8_t columns, uint8_t rows>
+struct serpentine
+{
+    static const uint8_t width = columns;
+    static const uint8_t height = rows;
+
+    static uint16_t index( uint8_t x, uint8_t y)
+    {
+        return static_cast<uint16_t>( y) * width + ((y & 1) ? width - 1 - x : x);
+    }
+
+    static int16_t row_step( uint8_t y)
+    {
+        return (y & 1) ? -1 : 1;
+    }
+
+    static int16_t column_step( uint8_t)
+    {
+        return 0;
+    }
+};
+
+/**
+ * Columns run from top to bottom and follow each other from left to right.
+ */
+template< uint8_t columns, uint8_t rows>
+struct column_major
+{
+    static const uint8_t width = columns;
+    static const uint8_t height = rows;
+
+    static uint16_t index( uint8_t x, uint8_t y)
+    {
+        return static_cast<uint16_t>( x) * height + y;
+    }
+
+    static int16_t row_step( uint8_t)
+    {
+        return height;
+    }
+
+    static int16_t column_step( uint8_t)
+    {
+        return 1;
+    }
+};
+
+/**
+ * A layout that is described by a table in program memory, with one byte per pixel, row by row.
+ * Each byte holds the position of that pixel in the LED string, which limits table layouts to 256 LEDs.
+ *
+ * Because the table is a template argument it must have external linkage, e.g.:
+ *
+ *     extern const uint8_t my_panel[] PROGMEM = { ... };
+ *     matrix< table_layout<5, 5, my_panel> > panel( leds);
+ */
+template< uint8_t columns, uint8_t rows, const uint8_t *table>
+struct table_layout
+{
+    static const uint8_t width = columns;
+    static const uint8_t height = rows;
+
+    static uint16_t index( uint8_t x, uint8_t y)
+    {
+        return pgm_read_byte( &table[static_cast<uint16_t>( y) * width + x]);
+    }
+
+    static int16_t row_step( uint8_t)
+    {
+        return 0;
+    }
+
+    static int16_t column_step( uint8_t)
+    {
+        return 0;
+    }
+};
+
+/**
+ * A two-dimensional view on an array of LEDs.
+ * The array is owned by the caller and must hold exactly width x height LEDs.
+ */
+template< typename layout>
+struct matrix
+{
+    typedef layout layout_type;
+
+    template< uint16_t array_size>
+    explicit matrix( rgb (&leds)[array_size])
+    :buffer( leds)
+    {
+        // fails to compile if the array does not match the layout.
+        typedef char array_size_must_match_layout[array_size == static_cast<uint16_t>( layout::width) * layout::height ? 1 : -1] __attribute__((unused));
+    }
+
+    rgb *buffer;
+};
+
+template< typename layout>
+struct led_buffer_traits<matrix<layout> >
+{
+    static const uint16_t count = static_cast<uint16_t>( layout::width) * layout::height;
+    static const uint16_t size = sizeof( rgb) * count;
+
+    typedef rgb *iterator;
+    static const bool contiguous = true;
+    static iterator begin( matrix<layout> &leds) { return leds.buffer; }
+    static iterator end( matrix<layout> &leds) { return leds.buffer + count; }
+};
+
+template< typename layout>
+inline rgb &get( matrix<layout> &leds, uint16_t index)
+{
+    return leds.buffer[index];
+}
+
+template< typename layout>
+inline rgb &get( matrix<layout> &leds, uint8_t x, uint8_t y)
+{
+    return leds.buffer[layout::index( x, y)];
+}
+
+/**
+ * Copy 'count' pixels to a row of the matrix, starting at (x, y) and going right.
+ */
+template< typename layout>
+void write_row( matrix<layout> &leds, uint8_t x, uint8_t y, const rgb *values, uint8_t count)
+{
+    const int16_t step = layout::row_step( y);
+    if (step)
+    {
+        rgb *led = &leds.buffer[layout::index( x, y)];
+        while (count--)
+        {
+            *led = *values++;
+            led += step;
+        }
+    }
+    else
+    {
+        while (count--)
+        {
+            leds.buffer[layout::index( x++, y)] = *values++;
+        }
+    }
+}
+
+/**
+ * Copy 'count' pixels to a column of the matrix, starting at (x, y) and going down.
+ */
+template< typename layout>
+void write_column( matrix<layout> &leds, uint8_t x, uint8_t y, const rgb *values, uint8_t count)
+{
+    const int16_t step = layout::column_step( x);
+    if (step)
+    {
+        rgb *led = &leds.buffer[layout::index( x, y)];
+        while (count--)
+        {
+            *led = *values++;
+            led += step;
+        }
+    }
+    else
+    {
+        while (count--)
+        {
+            leds.buffer[layout::index( x, y++)] = *values++;
+        }
+    }
+}
+
+template< typename layout>
+inline void send( const matrix<layout> &leds, uint8_t bit)
+{
+    send( leds.buffer, led_buffer_traits<matrix<layout> >::count, bit);
+}
+
+template< typename port_type, typename layout>
+inline void send( const matrix<layout> &leds, uint8_t bit)
+{
+    send<port_type>( leds.buffer, led_buffer_traits<matrix<layout> >::count, bit);
+}
+
+}
+
+#endif /* MATRIX_HPP_ */
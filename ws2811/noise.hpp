@@ -0,0 +1,111 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * 8-bit fixed point value noise and palette lookup.
+ *
+ * Value noise assigns a pseudo-random value to every point of an integer lattice and interpolates smoothly
+ * between those points. Coordinates are 8.8 fixed point numbers: the high byte selects the lattice cell, the
+ * low byte is the position within the cell. The lattice values come from a 64-byte table in flash, so the noise
+ * repeats after 64 units in each direction.
+ *
+ * An organic effect typically takes the LED position as one coordinate and time as the other and maps the noise value
+ * to a color with a 16-entry palette. This costs the same for every LED, independent of the contents of
+ * the animation: roughly 100 cycles per LED for noise2() and map_palette() together on devices with MUL.
+ */
+
+#ifndef NOISE_HPP_
+#define NOISE_HPP_
+#include <avr/pgmspace.h>
+#include "rgb.h"
+
+namespace ws2811
+{
+namespace detail {
+
+inline uint8_t lattice( uint8_t x, uint8_t y)
+{
+    static const uint8_t values[64] PROGMEM = {
+        165,  77, 202,  24,  37,  48, 187,  29, 109,  19,  44, 222, 214,  35, 123,  46,
+        217,  30,  63, 114,  31, 203,  25, 113,  23,  68, 148, 214,  73,  60, 157,  92,
+         52,  96, 190,  49,  32,  30, 105, 254, 218, 160, 238, 232, 185, 153, 127,  92,
+        124,  41, 153, 253, 175, 229, 147,  37,  60, 214,  84, 175,  77, 250, 215,  20,
+    };
+    return pgm_read_byte( &values[(pgm_read_byte( &values[x & 0x3f]) + y) & 0x3f]);
+}
+
+/// smoothstep (3t^2 - 2t^3) for t in 0-255, so that the noise has no visible kinks at lattice points.
+/// This is calculated as t^2 * (3 - 2t), where the intermediate result just fits in 16 bits.
+inline uint8_t ease( uint8_t t)
+{
+    const uint16_t squared = (static_cast<uint16_t>( t) * t) >> 8;
+    return (squared * (384 - t)) >> 7;
+}
+
+/// interpolate between a (t = 0) and b (t = 256).
+inline uint8_t lerp( uint8_t a, uint8_t b, uint8_t t)
+{
+    return a + ((static_cast<int16_t>( b - a) * t) >> 8);
+}
+}
+
+/**
+ * One-dimensional value noise at the 8.8 fixed point coordinate x.
+ */
+inline uint8_t noise1( uint16_t x)
+{
+    const uint8_t cell = x >> 8;
+    return detail::lerp(
+            detail::lattice( cell, 0),
+            detail::lattice( cell + 1, 0),
+            detail::ease( x));
+}
+
+/**
+ * Two-dimensional value noise at the 8.8 fixed point coordinates x and y.
+ */
+inline uint8_t noise2( uint16_t x, uint16_t y)
+{
+    using detail::lattice;
+    using detail::lerp;
+
+    const uint8_t cell_x = x >> 8;
+    const uint8_t cell_y = y >> 8;
+    const uint8_t tx = detail::ease( x);
+    const uint8_t ty = detail::ease( y);
+
+    return lerp(
+            lerp( lattice( cell_x, cell_y), lattice( cell_x + 1, cell_y), tx),
+            lerp( lattice( cell_x, cell_y + 1), lattice( cell_x + 1, cell_y + 1), tx),
+            ty);
+}
+
+/**
+ * Map a value in the range 0-255 to a color of a 16-entry palette in flash memory, interpolating
+ * between neighboring entries. Value 0 maps to the first entry and values from 240 up
+ * map to the last entry.
+ *
+ * The palette consists of 16 colors of 3 bytes each, in R, G, B order.
+ */
+inline rgb map_palette( const uint8_t *palette, uint8_t value)
+{
+    using detail::lerp;
+
+    const uint8_t index = value >> 4;
+    const uint8_t t = value << 4;
+    const uint8_t *low = palette + 3 * index;
+    const uint8_t *high = index < 15 ? low + 3 : low;
+
+    return rgb(
+            lerp( pgm_read_byte( low), pgm_read_byte( high), t),
+            lerp( pgm_read_byte( low + 1), pgm_read_byte( high + 1), t),
+            lerp( pgm_read_byte( low + 2), pgm_read_byte( high + 2), t));
+}
+
+}
+
+#endif /* NOISE_HPP_ */
@@ -0,0 +1,179 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * A LED buffer that stores colors as packed 16-bit RGB565 values.
+ *
+ * A regular rgb array uses 3 bytes per LED, this buffer uses 2, which means that the same amount
+ * of RAM can hold 50% more LEDs. The price is color resolution: red and blue keep their 5 most
+ * significant bits, green keeps 6 bits.
+ *
+ * Because the values can not be accessed by reference, get() on a non-const buffer returns a proxy
+ * that packs a value when it is assigned, so that effects that write get( leds, index) = value work
+ * unchanged. Functions that modify an LED through an rgb reference, such as add_clipped(), do not accept it.
+ * set_dithered() rounds up or down depending on the LED position (ordered dithering), so that
+ * the average color over a few neighboring LEDs is closer to the requested color. This gives
+ * smoother gradients and fades, especially at low intensities where the steps of
+ * the 5-bit channels are most visible.
+ *
+ * send() expands the values to 24 bits on the fly, one LED at a time. This keeps the data line low
+ * for about 5us between LEDs (at 8Mhz), which is well below the reset time of the controllers.
+ */
+
+#ifndef PACKED_LEDS_HPP_
+#define PACKED_LEDS_HPP_
+#include "ws2811.h"
+#include "rgb_operators.hpp"
+
+namespace ws2811
+{
+
+template< uint16_t led_count>
+struct packed_leds
+{
+    uint16_t buffer[led_count];
+};
+
+template< uint16_t led_count>
+struct led_buffer_traits<packed_leds<led_count> >
+{
+    static const uint16_t count = led_count;
+    static const uint16_t size = sizeof( uint16_t) * led_count;
+};
+
+/**
+ * Convert an rgb value to RGB565 by truncating the channels.
+ */
+inline uint16_t pack( const rgb &value)
+{
+    return
+            (static_cast<uint16_t>( value.red & 0xf8) << 8)
+        |   (static_cast<uint16_t>( value.green & 0xfc) << 3)
+        |   (value.blue >> 3);
+}
+
+/**
+ * Convert a RGB565 value to rgb. The top bits of each channel are repeated in the
+ * lower bits, so that the full range 0-255 is covered.
+ */
+inline rgb unpack( uint16_t packed)
+{
+    const uint8_t red = (packed >> 8) & 0xf8;
+    const uint8_t green = (packed >> 3) & 0xfc;
+    const uint8_t blue = packed << 3;
+    return rgb( red | (red >> 5), green | (green >> 6), blue | (blue >> 5));
+}
+
+/**
+ * Stands in for an rgb reference to an LED in a packed buffer.
+ */
+class packed_reference
+{
+public:
+    explicit packed_reference( uint16_t *packed)
+    :packed( packed)
+    {}
+
+    operator rgb() const
+    {
+        return unpack( *packed);
+    }
+
+    packed_reference &operator=( const rgb &value)
+    {
+        *packed = pack( value);
+        return *this;
+    }
+
+    packed_reference &operator=( const packed_reference &other)
+    {
+        *packed = *other.packed;
+        return *this;
+    }
+
+private:
+    uint16_t *packed;
+};
+
+template< uint16_t led_count>
+inline rgb get( const packed_leds<led_count> &leds, uint16_t index)
+{
+    return unpack( leds.buffer[index]);
+}
+
+template< uint16_t led_count>
+inline packed_reference get( packed_leds<led_count> &leds, uint16_t index)
+{
+    return packed_reference( &leds.buffer[index]);
+}
+
+template< uint16_t led_count>
+inline void set( packed_leds<led_count> &leds, uint16_t index, const rgb &value)
+{
+    leds.buffer[index] = pack( value);
+}
+
+template< uint16_t led_count>
+inline void set_scaled( packed_leds<led_count> &leds, uint16_t index, const rgb &color, uint8_t amplitude, const rgb &offset = rgb())
+{
+    set( leds, index, detail::scaled( color, amplitude, offset));
+}
+
+/**
+ * Store a value, rounding up or down depending on the position of the LED.
+ * Four consecutive LEDs with the same value will show the requested value on average.
+ */
+template< uint16_t led_count>
+inline void set_dithered( packed_leds<led_count> &leds, uint16_t index, const rgb &value)
+{
+    using detail::add_clipped;
+
+    // thresholds for the 6-bit green channel, the 5-bit channels use twice these values, plus one.
+    static const uint8_t thresholds[] = { 0, 2, 1, 3};
+    const uint8_t threshold = thresholds[index & 0x03];
+    leds.buffer[index] = pack(
+            rgb(
+                    add_clipped( value.red, 2 * threshold + 1),
+                    add_clipped( value.green, threshold),
+                    add_clipped( value.blue, 2 * threshold + 1)));
+}
+
+template< uint16_t led_count>
+inline void clear( packed_leds<led_count> &leds)
+{
+    memset( leds.buffer, 0, sizeof leds.buffer);
+}
+
+template< uint16_t led_count>
+inline void fill( packed_leds<led_count> &leds, const rgb &value)
+{
+    const uint16_t packed = pack( value);
+    for (uint16_t count = 0; count < led_count; ++count)
+    {
+        leds.buffer[count] = packed;
+    }
+}
+
+/**
+ * Send a packed buffer, expanding each LED to 24 bits just before it is sent.
+ */
+template< uint16_t led_count>
+void send( const packed_leds<led_count> &leds, uint8_t bit)
+{
+    const uint8_t mask = _BV( bit);
+    detail::reset( bit);
+    for (uint16_t index = 0; index < led_count; ++index)
+    {
+        const rgb value = unpack( leds.buffer[index]);
+        detail::send_bytes( &value, sizeof value, mask);
+    }
+    detail::end_frame( bit);
+}
+
+}
+
+#endif /* PACKED_LEDS_HPP_ */
@@ -0,0 +1,179 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Power budgeting for long LED strings.
+ *
+ * A power_tracked_leds buffer keeps the sum of all color channel values up to date while LEDs are written,
+ * so that the current that a frame will draw is known without scanning the buffer. send_limited() sends
+ * the buffer unchanged if it fits within a current budget and otherwise dims all LEDs by the same factor
+ * while sending, leaving the buffer itself untouched.
+ *
+ * Updating the sum costs about 20 cycles per set(). Checking the budget costs a single 32-bit comparison
+ * per frame. Only frames that exceed the budget pay for a division and for scaling each LED, which is done one LED
+ * at a time, just before that LED is sent.
+ *
+ * The estimate assumes that every channel draws 20mA at full intensity and that current is proportional
+ * to intensity, which is a reasonable model for WS2811 and WS2812 LEDs. The quiescent current of
+ * the controllers (roughly 1mA per LED) is not included and should be subtracted from the budget.
+ */
+
+#ifndef POWER_HPP_
+#define POWER_HPP_
+#include "ws2811.h"
+#include "rgb_operators.hpp"
+
+namespace ws2811
+{
+
+/// current of one color channel at full intensity.
+static const uint8_t milliamps_per_channel = 20;
+
+/**
+ * A dense LED buffer that keeps track of the sum of its channel values.
+ * LEDs must be written through get( leds, index) = value, set(), set_scaled(), fill() and clear().
+ */
+template< uint16_t led_count>
+struct power_tracked_leds
+{
+    power_tracked_leds()
+    :sum( 0)
+    {
+        memset( (void *)buffer, 0, sizeof buffer);
+    }
+
+    rgb         buffer[led_count];
+    uint32_t    sum;
+};
+
+template< uint16_t led_count>
+struct led_buffer_traits<power_tracked_leds<led_count> >
+{
+    static const uint16_t count = led_count;
+    static const uint16_t size = sizeof( rgb) * led_count;
+};
+
+namespace detail {
+inline uint16_t channel_sum( const rgb &value)
+{
+    return static_cast<uint16_t>( value.red) + value.green + value.blue;
+}
+}
+
+/**
+ * Stands in for an rgb reference to an LED in a power tracked buffer, so that effects that write
+ * get( leds, index) = value keep the sum up to date.
+ * Functions that take an rgb reference, such as add_clipped(), do not accept it.
+ */
+class power_tracked_reference
+{
+public:
+    power_tracked_reference( rgb *value, uint32_t *sum)
+    :value( value), sum( sum)
+    {}
+
+    operator rgb() const
+    {
+        return *value;
+    }
+
+    power_tracked_reference &operator=( const rgb &new_value)
+    {
+        *sum -= detail::channel_sum( *value);
+        *sum += detail::channel_sum( new_value);
+        *value = new_value;
+        return *this;
+    }
+
+    power_tracked_reference &operator=( const power_tracked_reference &other)
+    {
+        return *this = static_cast<rgb>( other);
+    }
+
+private:
+    rgb         *value;
+    uint32_t    *sum;
+};
+
+template< uint16_t led_count>
+inline rgb get( const power_tracked_leds<led_count> &leds, uint16_t index)
+{
+    return leds.buffer[index];
+}
+
+template< uint16_t led_count>
+inline power_tracked_reference get( power_tracked_leds<led_count> &leds, uint16_t index)
+{
+    return power_tracked_reference( &leds.buffer[index], &leds.sum);
+}
+
+template< uint16_t led_count>
+inline void set( power_tracked_leds<led_count> &leds, uint16_t index, const rgb &value)
+{
+    get( leds, index) = value;
+}
+
+template< uint16_t led_count>
+inline void set_scaled( power_tracked_leds<led_count> &leds, uint16_t index, const rgb &color, uint8_t amplitude, const rgb &offset = rgb())
+{
+    set( leds, index, detail::scaled( color, amplitude, offset));
+}
+
+template< uint16_t led_count>
+inline void clear( power_tracked_leds<led_count> &leds)
+{
+    clear( leds.buffer);
+    leds.sum = 0;
+}
+
+template< uint16_t led_count>
+inline void fill( power_tracked_leds<led_count> &leds, const rgb &value)
+{
+    fill( leds.buffer, value);
+    leds.sum = static_cast<uint32_t>( detail::channel_sum( value)) * led_count;
+}
+
+/// estimated current of the LEDs in the buffer, excluding the quiescent current of the controllers.
+template< uint16_t led_count>
+inline uint16_t estimated_milliamps( const power_tracked_leds<led_count> &leds)
+{
+    return leds.sum * milliamps_per_channel / 255;
+}
+
+/**
+ * Send a buffer, dimming it if the LEDs would draw more than the given current.
+ */
+template< uint16_t led_count>
+void send_limited( const power_tracked_leds<led_count> &leds, uint8_t bit, uint16_t budget_milliamps)
+{
+    const uint32_t allowed = static_cast<uint32_t>( budget_milliamps) * 255 / milliamps_per_channel;
+    if (leds.sum <= allowed)
+    {
+        send( leds.buffer, bit);
+        return;
+    }
+
+    // scale8() multiplies with (factor + 1)/256, which must not exceed allowed/sum.
+    const uint16_t ratio = (allowed << 8) / leds.sum;
+    const uint8_t factor = ratio ? ratio - 1 : 0;
+    const uint8_t mask = _BV( bit);
+    detail::reset( bit);
+    for (uint16_t index = 0; index < led_count; ++index)
+    {
+        const rgb &original = leds.buffer[index];
+        const rgb value(
+                detail::scale8( original.red, factor),
+                detail::scale8( original.green, factor),
+                detail::scale8( original.blue, factor));
+        detail::send_bytes( &value, sizeof value, mask);
+    }
+    detail::end_frame( bit);
+}
+
+}
+
+#endif /* POWER_HPP_ */
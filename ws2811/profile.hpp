@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Optional timing of the render and send phases of effects.
+ *
+ * If the macro WS2811_PROFILE_CLOCK is defined as the name of a clock type (see clock.hpp), run_effect() and
+ * the scheduler measure how long each render() and each send() takes and keep minimum, average and maximum
+ * per pin. This shows whether a string is limited by effect code or by the time it takes to send the data. E.g.:
+ *
+ * #define WS2811_PROFILE_CLOCK ws2811::timer1_clock
+ * ...
+ * ws2811::timer1_clock::init();
+ *
+ * The statistics can be inspected in RAM, e.g. in a simulator, through ws2811::profile( pin), or written
+ * as text with write_profile(). Times are in clock ticks: 8us for the timer1_clock at 8Mhz. A clock that
+ * runs at F_CPU counts cycles instead, but then no phase should take longer than 65535 cycles.
+ *
+ * When enabled, profiling takes 160 bytes of RAM and roughly 100 cycles per frame. When the macro is not
+ * defined, all profiling code compiles to nothing.
+ */
+
+#ifndef PROFILE_HPP_
+#define PROFILE_HPP_
+#include <avr/io.h>
+
+#if defined( WS2811_PROFILE_CLOCK)
+#   include "clock.hpp"
+#endif
+
+namespace ws2811
+{
+
+/**
+ * Minimum, maximum and average duration of one phase of a frame.
+ */
+struct phase_statistics
+{
+    uint16_t minimum;
+    uint16_t maximum;
+    uint16_t count;
+    uint32_t total;
+
+    void record( uint16_t ticks)
+    {
+        if (!count || ticks < minimum) minimum = ticks;
+        if (ticks > maximum) maximum = ticks;
+        if (count == 0xffff)
+        {
+            // restart the average before the count can overflow.
+            total /= count;
+            count = 1;
+        }
+        total += ticks;
+        ++count;
+    }
+
+    uint16_t average() const
+    {
+        return count ? total / count : 0;
+    }
+};
+
+struct frame_statistics
+{
+    phase_statistics render;
+    phase_statistics send;
+};
+
+#if defined( WS2811_PROFILE_CLOCK)
+
+/// statistics for the given pin.
+inline frame_statistics &profile( uint8_t pin)
+{
+    static frame_statistics statistics[8];
+    return statistics[pin];
+}
+
+namespace detail {
+
+/**
+ * Stopwatch for the phases of a single frame.
+ * Construct it just before rendering, call rendered() after rendering and sent() after sending.
+ */
+class frame_stopwatch
+{
+public:
+    frame_stopwatch()
+    :start( WS2811_PROFILE_CLOCK::now())
+    {}
+
+    void rendered( uint8_t pin)
+    {
+        profile( pin).render.record( lap());
+    }
+
+    void sent( uint8_t pin)
+    {
+        profile( pin).send.record( lap());
+    }
+
+private:
+    uint16_t lap()
+    {
+        const uint16_t now = WS2811_PROFILE_CLOCK::now();
+        const uint16_t result = now - start;
+        start = now;
+        return result;
+    }
+
+    uint16_t start;
+};
+
+inline void write_decimal( void (*put)( uint8_t), uint16_t value)
+{
+    char digits[5];
+    uint8_t count = 0;
+    do
+    {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    while (count) put( digits[--count]);
+}
+
+inline void write_phase( void (*put)( uint8_t), const phase_statistics &phase)
+{
+    write_decimal( put, phase.minimum);
+    put( ' ');
+    write_decimal( put, phase.average());
+    put( ' ');
+    write_decimal( put, phase.maximum);
+}
+}
+
+/**
+ * Write the statistics of one pin as a line of text, using the given function to output characters.
+ * The format is: <pin>: r <min> <avg> <max> s <min> <avg> <max>
+ */
+inline void write_profile( uint8_t pin, void (*put)( uint8_t))
+{
+    const frame_statistics &statistics = profile( pin);
+    put( '0' + pin);
+    put( ':');
+    put( ' ');
+    put( 'r');
+    put( ' ');
+    detail::write_phase( put, statistics.render);
+    put( ' ');
+    put( 's');
+    put( ' ');
+    detail::write_phase( put, statistics.send);
+    put( '\r');
+    put( '\n');
+}
+
+#else
+
+namespace detail {
+
+/// without a profile clock, the stopwatch does nothing.
+class frame_stopwatch
+{
+public:
+    void rendered( uint8_t) {}
+    void sent( uint8_t) {}
+};
+}
+
+#endif
+}
+
+#endif /* PROFILE_HPP_ */
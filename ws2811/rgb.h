@@ -31,6 +31,8 @@ struct rgb
     uint8_t green;
     uint8_t blue;
 
+    /// byte offsets of the color components in memory
+    enum { red_offset = 0, green_offset = 1, blue_offset = 2};
 };
 #else
 
@@ -53,8 +55,50 @@ struct rgb
     uint8_t red;
     uint8_t blue;
 
+    /// byte offsets of the color components in memory
+    enum { red_offset = 1, green_offset = 0, blue_offset = 2};
 };
 #endif
+
+/**
+ * The order in which the color components of a single LED are put on the wire.
+ *
+ * The STRAIGHT_RGB macro determines the order in memory, which is also the order
+ * used by the plain send() functions. Strings that want their colors in a different
+ * order can be driven by passing one of these values to send(), which will then pick
+ * the bytes of each LED in the right order while clocking them out. This allows a
+ * single controller to drive both GRB and RGB strings from the same kind of buffer.
+ */
+enum color_order
+{
+    order_grb,
+    order_rgb,
+    order_brg,
+    order_bgr,
+    order_rbg,
+    order_gbr
+};
+
+/**
+ * Translates a color order into the memory offsets of the bytes that need to be
+ * sent first, second and third.
+ */
+template< color_order order>
+struct color_order_traits {};
+
+template<> struct color_order_traits<order_grb>
+{ enum { first = rgb::green_offset, second = rgb::red_offset,   third = rgb::blue_offset};};
+template<> struct color_order_traits<order_rgb>
+{ enum { first = rgb::red_offset,   second = rgb::green_offset, third = rgb::blue_offset};};
+template<> struct color_order_traits<order_brg>
+{ enum { first = rgb::blue_offset,  second = rgb::red_offset,   third = rgb::green_offset};};
+template<> struct color_order_traits<order_bgr>
+{ enum { first = rgb::blue_offset,  second = rgb::green_offset, third = rgb::red_offset};};
+template<> struct color_order_traits<order_rbg>
+{ enum { first = rgb::red_offset,   second = rgb::blue_offset,  third = rgb::green_offset};};
+template<> struct color_order_traits<order_gbr>
+{ enum { first = rgb::green_offset, second = rgb::blue_offset,  third = rgb::red_offset};};
+
 bool operator==( const rgb &lhs, const rgb &rhs)
 {
     return  lhs.red   == rhs.red &&
@@ -8,6 +8,10 @@
  * Operators for RGB values.
  * Specifically, this file contains functions for "clipped addition" where the values of two bytes that are added
  * will never overflow, but will instead be clipped at the maximum value of 255.
+ *
+ * It also contains fixed-point conversions from hue, saturation and value to rgb. These
+ * use 8-bit arithmetic only. On devices without a hardware multiplier (e.g. attiny13), the multiplications
+ * are done with a short shift-and-add loop instead of the 16-bit multiply routine of libgcc.
  */
 
 #ifndef RGB_OPERATORS_HPP_
@@ -35,6 +39,113 @@ namespace ws2811
 				);
 	}
 
+	namespace detail {
+		/**
+		 * Scale an 8-bit value by factor/256, where a factor of 255 leaves the value unchanged
+		 * and a factor of 0 results in zero.
+		 * This takes about 5 cycles on devices with MUL and about 60 cycles without.
+		 */
+		inline uint8_t scale8( uint8_t value, uint8_t factor)
+		{
+#ifdef __AVR_HAVE_MUL__
+			return (static_cast<uint16_t>( value) * factor + value) >> 8;
+#else
+			// shift-and-add, starting with 'value' to get the same rounding as
+			// the version above.
+			uint16_t result = value;
+			for (uint8_t bit = 0x01; bit; bit <<= 1)
+			{
+				if (factor & bit) result += value;
+				result >>= 1;
+			}
+			return result;
+#endif
+		}
+	}
+
+	/**
+	 * Fully saturated, full intensity color for a hue in the range 0-255.
+	 * The wheel goes from red (0) via green (85) and blue (170) back to red. There are no
+	 * multiplications involved, so this is equally fast with or without MUL: roughly 20 cycles.
+	 */
+	inline rgb hue_wheel( uint8_t hue)
+	{
+		if (hue < 85)
+		{
+			const uint8_t up = (hue << 1) + hue;
+			return rgb( 255 - up, up, 0);
+		}
+		else if (hue < 170)
+		{
+			hue -= 85;
+			const uint8_t up = (hue << 1) + hue;
+			return rgb( 0, 255 - up, up);
+		}
+		else
+		{
+			hue -= 170;
+			const uint8_t up = (hue << 1) + hue;
+			return rgb( up, 0, 255 - up);
+		}
+	}
+
+	/**
+	 * Convert hue, saturation and value to rgb, all in the range 0-255.
+	 * The hue is first stretched to six sectors of 43 steps, so that all sectors are equally wide:
+	 * red (0), yellow (43), green (86), cyan (128), blue (171) and magenta (214).
+	 *
+	 * This takes roughly 70 cycles on devices with MUL and 250 cycles on devices without,
+	 * instead of several thousands for a floating point implementation.
+	 */
+	inline rgb hsv( uint8_t hue, uint8_t saturation, uint8_t value)
+	{
+		using detail::scale8;
+
+		// hue x 258 / 256, so that the last sector also has 43 steps.
+		uint16_t position = hue + (hue >> 7);
+		uint8_t sector = 0;
+		while (position >= 43)
+		{
+			position -= 43;
+			++sector;
+		}
+		const uint8_t rising = (position << 2) + (position << 1);
+		const uint8_t low = scale8( value, 255 - saturation);
+		const uint8_t up = scale8( value, 255 - scale8( saturation, 255 - rising));
+		const uint8_t down = scale8( value, 255 - scale8( saturation, rising));
+
+		switch (sector)
+		{
+		case 0: return rgb( value, up, low);
+		case 1: return rgb( down, value, low);
+		case 2: return rgb( low, value, up);
+		case 3: return rgb( low, down, value);
+		case 4: return rgb( up, low, value);
+		default: return rgb( value, low, down);
+		}
+	}
+
+	/**
+	 * Fill a range of leds with a hue gradient in a single pass.
+	 * Start hue and hue step are 8.8 fixed point values, so that a gradient can
+	 * span less than one hue step per LED. For instance, a hue_step of 65536L / led_count shows
+	 * the complete color circle exactly once.
+	 */
+	template< uint16_t led_count>
+	void fill_hue_gradient(
+			rgb (&leds)[led_count],
+			uint16_t start_hue,
+			uint16_t hue_step,
+			uint8_t saturation = 255,
+			uint8_t value = 255)
+	{
+		for (uint16_t idx = 0; idx < led_count; ++idx)
+		{
+			leds[idx] = hsv( start_hue >> 8, saturation, value);
+			start_hue += hue_step;
+		}
+	}
+
 	inline rgb scale( uint16_t scale, const rgb &original)
 	{
 	    return rgb(
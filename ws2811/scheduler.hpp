@@ -0,0 +1,259 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * A simple scheduler that runs several effects, each on its own pin, from a single loop.
+ *
+ * Each effect is wrapped in a task that holds the effect, its LED buffer, the pin on which
+ * it is sent and the time between frames. The scheduler always runs the task with the earliest
+ * deadline: it waits for that deadline, lets the effect step and render one frame and sends the buffer.
+ * While one task waits out its frame period, the others can render and send. Effects that run on zones
+ * of the same string share a zones_task, which sends the string once per frame (see segment.hpp).
+ *
+ * The scheduler counts the frames of each task and reports the achieved frame rate per task,
+ * which shows whether the channels together fit in the available CPU time.
+ *
+ * If WS2811_IDLE_CLOCK is defined (see clock.hpp), the scheduler sleeps until the next deadline instead
+ * of polling the clock. The idle clock must then be the same clock that the scheduler uses.
+ */
+
+#ifndef SCHEDULER_HPP_
+#define SCHEDULER_HPP_
+#include "ws2811.h"
+#include "profile.hpp"
+
+#if defined( WS2811_IDLE_CLOCK)
+#   include "clock.hpp"
+#endif
+
+namespace ws2811
+{
+
+/**
+ * Scheduler bookkeeping for one channel.
+ * Objects of this type are created through the effect_task template below.
+ */
+struct task
+{
+    typedef void (*frame_function)( task &);
+
+    task( frame_function frame, uint8_t pin, uint16_t period)
+    :frame( frame), pin( pin), period( period), deadline( 0), frames( 0), frame_rate( 0)
+    {}
+
+    frame_function  frame;      ///< renders and sends one frame
+    uint8_t         pin;        ///< the pin of the default port (see WS2811_PORT) that this task sends on
+    uint16_t        period;     ///< time between frames, in clock ticks
+    uint16_t        deadline;   ///< time at which the next frame is due
+    uint8_t         frames;     ///< frames sent in the current measurement window
+    uint16_t        frame_rate; ///< frames per second, measured over the last window
+};
+
+/**
+ * A task that lets an effect do one step and, if anything changed, renders it into a buffer and
+ * sends that buffer. The effect type must implement the interface described in effect.hpp.
+ */
+template< typename effect_type, typename buffer_type>
+struct effect_task : public task
+{
+    effect_task( effect_type &effect, buffer_type &buffer, uint8_t pin, uint16_t period)
+    :task( &effect_task::do_frame, pin, period), effect( effect), buffer( buffer)
+    {}
+
+    effect_type &effect;
+    buffer_type &buffer;
+
+private:
+    static void do_frame( task &t)
+    {
+        effect_task &self = static_cast<effect_task &>( t);
+        if (self.effect.step())
+        {
+            detail::frame_stopwatch stopwatch;
+            self.effect.render( self.buffer);
+            stopwatch.rendered( self.pin);
+            send( self.buffer, self.pin);
+            stopwatch.sent( self.pin);
+        }
+    }
+};
+
+/**
+ * One zone of a zones_task: an effect that renders into a part of the task's buffer, usually a segment
+ * (see segment.hpp). Objects of this type are created through the effect_zone template below.
+ */
+struct zone
+{
+    typedef bool (*frame_function)( zone &);
+
+    explicit zone( frame_function frame)
+    :frame( frame)
+    {}
+
+    frame_function  frame;      ///< steps the effect and renders it if it changed, returns true if it rendered
+};
+
+template< typename effect_type, typename zone_type>
+struct effect_zone : public zone
+{
+    effect_zone( effect_type &effect, zone_type &leds)
+    :zone( &effect_zone::do_frame), effect( effect), leds( leds)
+    {}
+
+    effect_type &effect;
+    zone_type   &leds;
+
+private:
+    static bool do_frame( zone &z)
+    {
+        effect_zone &self = static_cast<effect_zone &>( z);
+        if (!self.effect.step()) return false;
+        self.effect.render( self.leds);
+        return true;
+    }
+};
+
+/**
+ * A task that runs several effects on zones of the same LED string. Every frame, the effect of each
+ * zone steps and, if it changed, renders into its zone. If any zone changed, the string is sent once.
+ * All zones step at the period of the task, the frame_ms of their effects is not used.
+ */
+template< typename buffer_type, uint8_t zone_count>
+struct zones_task : public task
+{
+    zones_task( zone * const (&zones)[zone_count], buffer_type &buffer, uint8_t pin, uint16_t period)
+    :task( &zones_task::do_frame, pin, period), zones( zones), buffer( buffer)
+    {}
+
+    zone * const (&zones)[zone_count];
+    buffer_type &buffer;
+
+private:
+    static void do_frame( task &t)
+    {
+        zones_task &self = static_cast<zones_task &>( t);
+        detail::frame_stopwatch stopwatch;
+        bool changed = false;
+        for (uint8_t idx = 0; idx < zone_count; ++idx)
+        {
+            if (self.zones[idx]->frame( *self.zones[idx])) changed = true;
+        }
+        if (changed)
+        {
+            stopwatch.rendered( self.pin);
+            send( self.buffer, self.pin);
+            stopwatch.sent( self.pin);
+        }
+    }
+};
+
+/**
+ * Earliest-deadline-first scheduler for a fixed number of tasks.
+ *
+ * The clock type provides the time base (see clock.hpp), which must have been started before run()
+ * is called. Task periods are expressed in ticks of this clock.
+ *
+ * If a task misses its deadline by more than one period, the missed frames are skipped instead
+ * of being rendered back-to-back, the achieved frame rate will show this.
+ */
+template< typename clock, uint8_t task_count>
+class scheduler
+{
+public:
+    /// length of the window over which frame rates are measured.
+    static const uint16_t window_ms = 250;
+
+    explicit scheduler( task * const (&tasks)[task_count])
+    :tasks( tasks), window_start( 0)
+    {}
+
+    /// run all tasks, forever.
+    void run()
+    {
+        start();
+        for (;;)
+        {
+            step();
+        }
+    }
+
+    /// make all tasks due immediately and start measuring frame rates.
+    void start()
+    {
+        const uint16_t now = clock::now();
+        for (uint8_t idx = 0; idx < task_count; ++idx)
+        {
+            tasks[idx]->deadline = now;
+            tasks[idx]->frames = 0;
+        }
+        window_start = now;
+    }
+
+    /// wait for the task with the earliest deadline and let it render and send one frame.
+    void step()
+    {
+        task &next = earliest();
+#if defined( WS2811_IDLE_CLOCK)
+        WS2811_IDLE_CLOCK::sleep_until( next.deadline);
+#else
+        while (static_cast<int16_t>( clock::now() - next.deadline) < 0) /* wait */;
+#endif
+
+        next.frame( next);
+        ++next.frames;
+        next.deadline += next.period;
+
+        const uint16_t now = clock::now();
+        if (static_cast<int16_t>( now - next.deadline) > 0)
+        {
+            // we're more than one period late, don't try to catch up.
+            next.deadline = now;
+        }
+        update_frame_rates( now);
+    }
+
+    /// the frame rate that was achieved by the given task over the last measurement window.
+    uint16_t frame_rate( uint8_t index) const
+    {
+        return tasks[index]->frame_rate;
+    }
+
+private:
+    task &earliest() const
+    {
+        const uint16_t now = clock::now();
+        task *result = tasks[0];
+        for (uint8_t idx = 1; idx < task_count; ++idx)
+        {
+            if (static_cast<int16_t>( tasks[idx]->deadline - now) < static_cast<int16_t>( result->deadline - now))
+            {
+                result = tasks[idx];
+            }
+        }
+        return *result;
+    }
+
+    void update_frame_rates( uint16_t now)
+    {
+        if (static_cast<uint16_t>( now - window_start) >= window_ms * clock::ticks_per_ms)
+        {
+            for (uint8_t idx = 0; idx < task_count; ++idx)
+            {
+                tasks[idx]->frame_rate = tasks[idx]->frames * (1000 / window_ms);
+                tasks[idx]->frames = 0;
+            }
+            window_start = now;
+        }
+    }
+
+    task * const (&tasks)[task_count];
+    uint16_t window_start;
+};
+
+}
+
+#endif /* SCHEDULER_HPP_ */
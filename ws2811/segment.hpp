@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Segments: independent zones of a single LED string.
+ *
+ * A segment is a view on a range of LEDs in another buffer. It behaves like a buffer of its own:
+ * led_buffer_traits gives its length as the LED count, get() takes positions relative to the start of the
+ * segment and clear(), fill(), write_run() and add_run() only touch the LEDs in the segment. This means
+ * that each effect can render into its own zone of a string, unaware of the other zones. A reversed
+ * segment runs from its last LED to its first, for zones that are mounted the other way around.
+ *
+ * Offset, length and direction are template arguments, so index calculations are folded at compile time.
+ *
+ * A zones_task of the scheduler (see scheduler.hpp) lets the effects of all zones step and render and then
+ * sends the complete string once:
+ *
+ *     rgb leds[144];
+ *     typedef segment< rgb[144], 0, 60> fire_zone;
+ *     typedef segment< rgb[144], 60, 84, true> chaser_zone;
+ *     fire_zone fire_leds( leds);
+ *     chaser_zone chaser_leds( leds);
+ *     ws2811::effect_zone< campfire_effect<fire_zone>, fire_zone> zone1( fire, fire_leds);
+ *     ws2811::effect_zone< chasers_effect<chaser_zone, ...>, chaser_zone> zone2( chasing, chaser_leds);
+ *     ws2811::zone * const zones[] = { &zone1, &zone2};
+ *     ws2811::zones_task< rgb[144], 2> task( zones, leds, channel, ...);
+ *
+ * Sending a segment also sends the complete string that it is a part of, so that run_effect() can drive a
+ * single zone.
+ *
+ * clear(), fill(), get(), write_run() and add_run() work for segments of any buffer whose get() returns an
+ * rgb reference, including sparse_leds. Iterators, and with them scroll(), are only available for segments of
+ * buffers with contiguous iterators, such as rgb arrays.
+ */
+
+#ifndef SEGMENT_HPP_
+#define SEGMENT_HPP_
+#include "ws2811.h"
+
+namespace ws2811
+{
+
+template< typename buffer_type, uint16_t offset, uint16_t length, bool reversed = false>
+struct segment
+{
+    explicit segment( buffer_type &leds)
+    :leds( leds)
+    {}
+
+    buffer_type &leds;
+
+private:
+    // fails to compile if the segment does not fit in the buffer.
+    typedef char segment_must_fit_in_buffer[offset + length <= led_buffer_traits<buffer_type>::count ? 1 : -1];
+};
+
+/**
+ * Iterator that walks backwards through an array of LEDs.
+ * Like std::reverse_iterator, it points one past the LED that it refers to.
+ */
+class reverse_led_iterator
+{
+public:
+    explicit reverse_led_iterator( rgb *next)
+    :next( next)
+    {}
+
+    rgb &operator*() const
+    {
+        return *(next - 1);
+    }
+
+    rgb *operator->() const
+    {
+        return next - 1;
+    }
+
+    reverse_led_iterator &operator++()
+    {
+        --next;
+        return *this;
+    }
+
+    bool operator==( const reverse_led_iterator &other) const
+    {
+        return next == other.next;
+    }
+
+    bool operator!=( const reverse_led_iterator &other) const
+    {
+        return next != other.next;
+    }
+
+private:
+    rgb *next;
+};
+
+namespace detail {
+template< bool reversed>
+struct segment_direction
+{
+    typedef rgb *iterator;
+    static uint16_t index( uint16_t position, uint16_t) { return position; }
+    static iterator begin( rgb *first, uint16_t) { return first; }
+    static iterator end( rgb *first, uint16_t length) { return first + length; }
+};
+
+template<>
+struct segment_direction<true>
+{
+    typedef reverse_led_iterator iterator;
+    static uint16_t index( uint16_t position, uint16_t length) { return length - 1 - position; }
+    static iterator begin( rgb *first, uint16_t length) { return iterator( first + length); }
+    static iterator end( rgb *first, uint16_t) { return iterator( first); }
+};
+}
+
+template< typename buffer_type, uint16_t offset, uint16_t length, bool reversed>
+struct led_buffer_traits<segment<buffer_type, offset, length, reversed> >
+{
+    static const uint16_t count = length;
+    static const uint16_t size = sizeof( rgb) * length;
+
+    typedef typename detail::segment_direction<reversed>::iterator iterator;
+    static const bool contiguous = !reversed && led_buffer_traits<buffer_type>::contiguous;
+
+    static iterator begin( segment<buffer_type, offset, length, reversed> &leds)
+    {
+        return detail::segment_direction<reversed>::begin( led_buffer_traits<buffer_type>::begin( leds.leds) + offset, length);
+    }
+
+    static iterator end( segment<buffer_type, offset, length, reversed> &leds)
+    {
+        return detail::segment_direction<reversed>::end( led_buffer_traits<buffer_type>::begin( leds.leds) + offset, length);
+    }
+};
+
+template< typename buffer_type, uint16_t offset, uint16_t length, bool reversed>
+inline rgb &get( segment<buffer_type, offset, length, reversed> &leds, uint16_t position)
+{
+    return get( leds.leds, offset + detail::segment_direction<reversed>::index( position, length));
+}
+
+template< typename buffer_type, uint16_t offset, uint16_t length>
+inline void write_run( segment<buffer_type, offset, length, false> &leds, uint16_t position, const rgb *values, uint16_t count)
+{
+    write_run( leds.leds, offset + position, values, count);
+}
+
+template< typename buffer_type, uint16_t offset, uint16_t length>
+inline void add_run( segment<buffer_type, offset, length, false> &leds, uint16_t position, const rgb *values, uint16_t count)
+{
+    add_run( leds.leds, offset + position, values, count);
+}
+
+/**
+ * In a reversed segment, a run is stored back to front, so it is written LED by LED.
+ */
+template< typename buffer_type, uint16_t offset, uint16_t length>
+void write_run( segment<buffer_type, offset, length, true> &leds, uint16_t position, const rgb *values, uint16_t count)
+{
+    while (count--) get( leds, position++) = *values++;
+}
+
+template< typename buffer_type, uint16_t offset, uint16_t length>
+void add_run( segment<buffer_type, offset, length, true> &leds, uint16_t position, const rgb *values, uint16_t count)
+{
+    while (count--) add_clipped( get( leds, position++), *values++);
+}
+
+/**
+ * Make the LEDs of a segment black. For sparse buffers this only overwrites values that are already stored.
+ */
+template< typename buffer_type, uint16_t offset, uint16_t length, bool reversed>
+inline void clear( segment<buffer_type, offset, length, reversed> &leds)
+{
+    clear_run( leds.leds, offset, length);
+}
+
+template< typename buffer_type, uint16_t offset, uint16_t length, bool reversed>
+inline void fill( segment<buffer_type, offset, length, reversed> &leds, const rgb &value)
+{
+    for (uint16_t position = offset; position < offset + length; ++position)
+    {
+        get( leds.leds, position) = value;
+    }
+}
+
+/// send the complete string that the segment is part of.
+template< typename buffer_type, uint16_t offset, uint16_t length, bool reversed>
+inline void send( const segment<buffer_type, offset, length, reversed> &leds, uint8_t bit)
+{
+    send( leds.leds, bit);
+}
+
+template< typename port_type, typename buffer_type, uint16_t offset, uint16_t length, bool reversed>
+inline void send( const segment<buffer_type, offset, length, reversed> &leds, uint8_t bit)
+{
+    send<port_type>( leds.leds, bit);
+}
+
+}
+
+#endif /* SEGMENT_HPP_ */
@@ -0,0 +1,241 @@
+//
+// Copyright (c) 2013 Danny Havenith
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+/**
+ * Receiver for LED frames that are streamed from a host over the USART.
+ *
+ * The framing is that of the Adalight protocol:
+ * 'A', 'd', 'a', <count high>, <count low>, <checksum>, R1, G1, B1, R2, G2, B2, etc...
+ *
+ * <count> is the number of LEDs in the frame minus one and <checksum> is
+ * <count high> xor <count low> xor 0x55.
+ *
+ * The receiver holds two LED buffers. Bytes are written into the back buffer, byte by byte,
+ * from the USART receive interrupt while the main loop sends the front buffer. When a complete
+ * frame has been received, the main loop can swap the buffers.
+ *
+ * Because bytes keep arriving while LEDs are being sent, the front buffer should be sent with
+ * send_interruptible(). At 500kbaud a byte arrives every 20us, while one LED takes about 32us
+ * to send, so on average 1.6 bytes arrive per LED. An interrupt window of send_interruptible() runs
+ * the handler only once, so the handler must read all bytes that are waiting, not just one:
+ *
+ *     ISR( USART_RX_vect)
+ *     {
+ *         while (UCSR0A & _BV( RXC0)) receiver.receive( UDR0);
+ *     }
+ *
+ * Between two windows at most two bytes arrive, which fits in the two-byte receive buffer of the USART.
+ *
+ * Throughput is determined by the serial line: a frame takes 6 + 3 * led_count bytes of 10 bits each,
+ * so at 500kbaud a 60 LED string can receive 268 frames per second and a 300 LED string 55.
+ */
+
+#ifndef USART_RECEIVER_HPP_
+#define USART_RECEIVER_HPP_
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "rgb.h"
+
+namespace ws2811
+{
+
+/**
+ * Initialize the USART for receiving at the given baud rate.
+ * This uses double speed mode, which gives exact baud rates of 250k, 500k and 1M at 8Mhz.
+ */
+inline void usart_init( uint32_t baud)
+{
+    UBRR0 = (F_CPU / 8 / baud) - 1;
+    UCSR0A = _BV( U2X0);
+    UCSR0C = _BV( UCSZ01) | _BV( UCSZ00); // 8 data bits, no parity, 1 stop bit
+    UCSR0B = _BV( RXEN0) | _BV( RXCIE0);
+}
+
+/**
+ * Double-buffered receiver for Adalight frames.
+ *
+ * The receive() member function should be called from the USART receive interrupt with each
+ * received byte. The main loop checks frame_ready(), calls swap() and then sends
+ * front_buffer().
+ *
+ * If the host sends more LEDs than led_count, the surplus is ignored. If a new frame arrives
+ * before the main loop has swapped buffers, the new frame is dropped.
+ */
+template< uint16_t led_count>
+class frame_receiver
+{
+public:
+    typedef rgb buffer_type[led_count];
+
+    frame_receiver()
+    :frames_received(0), frames_dropped(0), checksum_errors(0),
+     front( buffers[0]), back( buffers[1]),
+     state( header_a), ready(false), dropping( false),
+     remaining(0), current(0), channel(0), count_high(0), count_low(0)
+    {}
+
+    /**
+     * Process one received byte. This function is intended to be called from
+     * the USART receive interrupt.
+     */
+    void receive( uint8_t byte)
+    {
+        switch (state)
+        {
+        case header_a:
+            if (byte == 'A') state = header_d;
+            break;
+        case header_d:
+            // an 'A' that breaks off a header may be the start of the next one.
+            state = (byte == 'd')?header_a2:(byte == 'A')?header_d:header_a;
+            break;
+        case header_a2:
+            state = (byte == 'a')?header_count_high:(byte == 'A')?header_d:header_a;
+            break;
+        case header_count_high:
+            count_high = byte;
+            state = header_count_low;
+            break;
+        case header_count_low:
+            count_low = byte;
+            state = header_checksum;
+            break;
+        case header_checksum:
+            if (byte == (count_high ^ count_low ^ 0x55))
+            {
+                start_frame();
+            }
+            else
+            {
+                ++checksum_errors;
+                state = header_a;
+            }
+            break;
+        case pixels:
+            if (!dropping && current < end())
+            {
+                current[offset()] = byte;
+                if (++channel == 3)
+                {
+                    channel = 0;
+                    current += sizeof( rgb);
+                }
+            }
+            if (!--remaining)
+            {
+                finish_frame();
+            }
+            break;
+        }
+    }
+
+    /// return true if the back buffer contains a complete frame.
+    bool frame_ready() const
+    {
+        return ready;
+    }
+
+    /**
+     * swap front and back buffer. This should only be called when frame_ready()
+     * returns true, otherwise the front buffer may be only partially filled.
+     */
+    void swap()
+    {
+        uint8_t sreg = SREG;
+        cli();
+        rgb *tmp = front;
+        front = back;
+        back = tmp;
+        ready = false;
+        SREG = sreg;
+    }
+
+    /// The buffer that holds the last complete frame.
+    buffer_type &front_buffer()
+    {
+        return *reinterpret_cast<buffer_type *>( front);
+    }
+
+    // statistics
+    volatile uint16_t frames_received;
+    volatile uint16_t frames_dropped;
+    volatile uint16_t checksum_errors; ///< headers with a wrong checksum or an impossible LED count
+
+private:
+    /// largest number of LEDs in a frame, plus one, for which 3 bytes per LED fit in 'remaining'.
+    static const uint16_t max_count = 0xffff / 3;
+
+    enum stateval {
+        header_a,
+        header_d,
+        header_a2,
+        header_count_high,
+        header_count_low,
+        header_checksum,
+        pixels
+    };
+
+    void start_frame()
+    {
+        const uint16_t count = static_cast<uint16_t>( count_high) << 8 | count_low;
+        if (count >= max_count)
+        {
+            // the byte count of the frame would not fit in 16 bits, treat this as a corrupt header.
+            ++checksum_errors;
+            state = header_a;
+            return;
+        }
+        remaining = 3 * (count + 1);
+        dropping = ready;
+        current = reinterpret_cast<uint8_t *>( back);
+        channel = 0;
+        state = pixels;
+    }
+
+    void finish_frame()
+    {
+        if (dropping)
+        {
+            ++frames_dropped;
+        }
+        else
+        {
+            ++frames_received;
+            ready = true;
+        }
+        state = header_a;
+    }
+
+    uint8_t *end() const
+    {
+        return reinterpret_cast<uint8_t *>( back + led_count);
+    }
+
+    /// offset of the current channel within an rgb struct. The host sends R, G, B.
+    uint8_t offset() const
+    {
+        static const uint8_t offsets[] = { rgb::red_offset, rgb::green_offset, rgb::blue_offset};
+        return offsets[channel];
+    }
+
+    rgb             buffers[2][led_count];
+    rgb * volatile  front;
+    rgb * volatile  back;
+    stateval        state;
+    volatile bool   ready;
+    bool            dropping;
+    uint16_t        remaining;
+    uint8_t         *current;
+    uint8_t         channel;
+    uint8_t         count_high;
+    uint8_t         count_low;
+};
+
+}
+
+#endif /* USART_RECEIVER_HPP_ */
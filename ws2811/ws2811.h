@@ -8,15 +8,33 @@
 /**
  * This header does the following things
  * - It defines the macro WS2811_PORT to PORTC if it wasn't defined yet.
+ * - It defines port traits types, which select the output port at compile time.
+ * - It defines the reset (latch) function that is used before sending a frame.
  * - It includes the right version of ws2811_xx.h, depending on F_CPU
  * - It defines a convenience overload of the send()-function that auto-detects array sizes.
+ * - It defines overloads of send() that send LED values in a given color order.
+ * - It defines send_interruptible(), which allows interrupts between LEDs.
  */
 
 #ifndef WS2811_H_
 #define WS2811_H_
 #include <string.h> // for memset
+#include <avr/interrupt.h>
+#include <util/delay_basic.h>
 
 namespace ws2811 {
+/**
+ * Properties of a LED buffer type.
+ *
+ * Each buffer type provides the number of LEDs ('count') and its size in bytes ('size').
+ * Buffer types that give access to their LEDs by reference also provide:
+ * - an 'iterator' type that can be dereferenced to an rgb reference, incremented and compared,
+ * - static begin() and end() functions that return iterators for a buffer,
+ * - 'contiguous', which is true if the iterator is a plain pointer that visits every LED of the string.
+ *
+ * The generic clear(), fill() and scroll() below are built on these iterators, so they compile to
+ * pointer loops for arrays, while buffer types such as sparse_leds provide their own overloads.
+ */
 template<typename buffer_type>
 struct led_buffer_traits
 {
@@ -27,6 +45,145 @@ struct led_buffer_traits
 #	define WS2811_PORT PORTC
 #endif
 
+namespace ws2811 {
+
+/**
+ * Port traits.
+ *
+ * All send functions have overloads that take the output port as their first template
+ * argument, e.g.: send<ws2811::port_b>( leds, 3). The port is a compile time constant in the send loops,
+ * so a single program can drive strings on several ports without any run time dispatch. The functions
+ * without a port template argument send on default_port, which is the port given by the WS2811_PORT macro.
+ *
+ * A port traits type has a static function port() that returns the PORTx register. This function
+ * must be inlined, so that the address of the register becomes a constant that the assembly code can use.
+ * This requires compiling with optimization, which is needed for the delay functions anyway.
+ */
+struct default_port
+{
+    __attribute__((always_inline)) static volatile uint8_t &port() { return WS2811_PORT; }
+};
+
+#if defined( PORTA)
+struct port_a
+{
+    __attribute__((always_inline)) static volatile uint8_t &port() { return PORTA; }
+};
+#endif
+
+#if defined( PORTB)
+struct port_b
+{
+    __attribute__((always_inline)) static volatile uint8_t &port() { return PORTB; }
+};
+#endif
+
+#if defined( PORTC)
+struct port_c
+{
+    __attribute__((always_inline)) static volatile uint8_t &port() { return PORTC; }
+};
+#endif
+
+#if defined( PORTD)
+struct port_d
+{
+    __attribute__((always_inline)) static volatile uint8_t &port() { return PORTD; }
+};
+#endif
+}
+
+/**
+ * If the macro WS2811_LATCH_CLOCK is defined as the name of a clock type (see clock.hpp), the time
+ * at which the data line of each pin was last pulled low is recorded. Sending a new frame then only
+ * waits for the part of the 40us reset period that hasn't passed yet, instead of always waiting
+ * the full 40us. This is useful when effects spend more than 40us rendering, which is
+ * almost always. The clock must have been started before the first frame is sent, e.g.:
+ *
+ * #define WS2811_LATCH_CLOCK ws2811::timer1_clock
+ * ...
+ * ws2811::timer1_clock::init();
+ *
+ * Because the clock wraps around, a frame that is sent exactly a multiple of the wrap-around time
+ * after the previous one may wait up to the full reset period, like it would without a clock.
+ */
+#if defined( WS2811_LATCH_CLOCK)
+#   include "clock.hpp"
+#endif
+
+namespace ws2811 {
+namespace detail {
+
+#if defined( WS2811_LATCH_CLOCK)
+/// minimum number of clock ticks between the end of a frame and the start of the next.
+/// One tick is added, because the clock may tick directly after the line went low.
+static const uint16_t latch_ticks = (40 * WS2811_LATCH_CLOCK::ticks_per_ms + 999) / 1000 + 1;
+
+/// per pin of the given port, the time at which the data line was last pulled low.
+template< typename port_type>
+inline uint16_t &line_low_since( uint8_t bit)
+{
+    static uint16_t stamps[8];
+    return stamps[bit];
+}
+
+/**
+ * Make sure that the data line is low and return when it has been low for 40us.
+ */
+template< typename port_type>
+inline void reset( uint8_t bit)
+{
+    const uint8_t mask = _BV( bit);
+    if (port_type::port() & mask)
+    {
+        port_type::port() &= ~mask;
+        line_low_since<port_type>( bit) = WS2811_LATCH_CLOCK::now();
+    }
+    const uint16_t since = line_low_since<port_type>( bit);
+    while (static_cast<uint16_t>( WS2811_LATCH_CLOCK::now() - since) < latch_ticks) /* wait */;
+}
+
+/**
+ * Record that the data line was pulled low at the end of a frame.
+ */
+template< typename port_type>
+inline void end_frame( uint8_t bit)
+{
+    line_low_since<port_type>( bit) = WS2811_LATCH_CLOCK::now();
+}
+
+#else
+
+/**
+ * Reset the controllers by pulling the data line low for 40us.
+ */
+template< typename port_type>
+inline void reset( uint8_t bit)
+{
+    port_type::port() &= ~_BV( bit);
+    _delay_loop_1( (F_CPU / 100000 * 4 + 2) / 3); // 40us, 3 ticks per loop
+}
+
+/// without a clock there is no need to record the end of a frame.
+template< typename port_type>
+inline void end_frame( uint8_t)
+{
+}
+#endif
+
+/// reset() and end_frame() for the port given by the WS2811_PORT macro.
+inline void reset( uint8_t bit)
+{
+    reset<default_port>( bit);
+}
+
+inline void end_frame( uint8_t bit)
+{
+    end_frame<default_port>( bit);
+}
+}
+}
+
 #if (F_CPU == 8000000)
 #   include "../ws2811/ws2811_8.h"
 #elif (F_CPU == 9600000)
@@ -34,6 +191,7 @@ struct led_buffer_traits
 #else
 #   error "ws2811 code works with clock frequencies of 8Mhz or 9.6Mhz only."
 #endif
+#include "rgb_operators.hpp"
 
 namespace ws2811 {
 
@@ -47,33 +205,317 @@ inline void send( const rgb (&values)[array_size], uint8_t bit)
 	send( &values[0], array_size, bit);
 }
 
+template< typename port_type, uint16_t array_size>
+inline void send( const rgb (&values)[array_size], uint8_t bit)
+{
+	send<port_type>( &values[0], array_size, bit);
+}
+
+/**
+ * Send the rgb values in the color order given as template argument.
+ * Only the send loop for this color order will be linked into the program.
+ */
+template< color_order order, uint16_t array_size>
+inline void send_ordered( const rgb (&values)[array_size], uint8_t bit)
+{
+    typedef color_order_traits<order> traits;
+    send_permuted< traits::first, traits::second, traits::third>( &values[0], array_size, bit);
+}
+
+template< color_order order, typename port_type, uint16_t array_size>
+inline void send_ordered( const rgb (&values)[array_size], uint8_t bit)
+{
+    typedef color_order_traits<order> traits;
+    send_permuted< traits::first, traits::second, traits::third, port_type>( &values[0], array_size, bit);
+}
+
+/**
+ * Send rgb values in a color order that is determined at run time, for instance
+ * when different pins of the same port drive LED strings with different color orders.
+ *
+ * Selecting the order costs nothing per LED, but note that every call to this function
+ * links in a send loop for each of the six possible orders. Use send_ordered() if the color order
+ * is known at compile time.
+ */
+template< typename port_type>
+void send( const void *values, uint16_t array_size, uint8_t bit, color_order order)
+{
+    switch (order)
+    {
+    case order_grb:
+        send_permuted< rgb::green_offset, rgb::red_offset, rgb::blue_offset, port_type>( values, array_size, bit);
+        break;
+    case order_rgb:
+        send_permuted< rgb::red_offset, rgb::green_offset, rgb::blue_offset, port_type>( values, array_size, bit);
+        break;
+    case order_brg:
+        send_permuted< rgb::blue_offset, rgb::red_offset, rgb::green_offset, port_type>( values, array_size, bit);
+        break;
+    case order_bgr:
+        send_permuted< rgb::blue_offset, rgb::green_offset, rgb::red_offset, port_type>( values, array_size, bit);
+        break;
+    case order_rbg:
+        send_permuted< rgb::red_offset, rgb::blue_offset, rgb::green_offset, port_type>( values, array_size, bit);
+        break;
+    case order_gbr:
+        send_permuted< rgb::green_offset, rgb::blue_offset, rgb::red_offset, port_type>( values, array_size, bit);
+        break;
+    }
+}
+
+inline void send( const void *values, uint16_t array_size, uint8_t bit, color_order order)
+{
+    send<default_port>( values, array_size, bit, order);
+}
+
+template< uint16_t array_size>
+inline void send( const rgb (&values)[array_size], uint8_t bit, color_order order)
+{
+    send( &values[0], array_size, bit, order);
+}
+
+template< typename port_type, uint16_t array_size>
+inline void send( const rgb (&values)[array_size], uint8_t bit, color_order order)
+{
+    send<port_type>( &values[0], array_size, bit, order);
+}
+
+/**
+ * Send rgb values with interrupts disabled while an LED is being sent, but with
+ * interrupts allowed between LEDs.
+ *
+ * The plain send() functions rely on cycle-exact timing and will produce garbage if an
+ * interrupt fires while they run, while disabling interrupts for the complete frame
+ * would block interrupts for 30us per LED (9ms for a 300 LED string).
+ * This function sends each LED with interrupts disabled and then, if interrupts were
+ * enabled when the function was called, allows pending interrupts to be handled before
+ * sending the next LED. If interrupts were disabled, they remain disabled.
+ *
+ * The reset before the first LED runs with interrupts enabled, so the worst case latency for an interrupt
+ * is the time it takes to send one LED (24 bits of 1.25us) plus the loop overhead, which is in the order
+ * of 35us at 8Mhz.
+ *
+ * While interrupt handlers run, the data line is low. If the line stays low for too long, the
+ * controllers will latch their data and treat the next LED as the first of a new frame. The
+ * WS2811 datasheet specifies a reset time of 50us, but some controllers latch much sooner, so the
+ * interrupt handlers that may run in one window together should finish well within 10us or so.
+ * Without any interrupt handlers running, the gap between LEDs is about 2-3us.
+ */
+template< typename port_type>
+void send_interruptible( const void *values, uint16_t array_size, uint8_t bit)
+{
+    const uint8_t mask = _BV(bit);
+    const uint8_t *leds = static_cast<const uint8_t *>( values);
+    const uint8_t sreg = SREG;
+
+    detail::reset<port_type>( bit);
+    cli();
+    while (array_size--)
+    {
+        detail::send_bytes<port_type>( leds, sizeof( rgb), mask);
+        leds += sizeof( rgb);
+        if (sreg & _BV(SREG_I))
+        {
+            // the instruction directly after sei will always be executed before any pending interrupt.
+            sei();
+            asm volatile ("nop");
+            cli();
+        }
+    }
+    detail::end_frame<port_type>( bit);
+    SREG = sreg;
+}
+
+inline void send_interruptible( const void *values, uint16_t array_size, uint8_t bit)
+{
+    send_interruptible<default_port>( values, array_size, bit);
+}
+
+template< uint16_t array_size>
+inline void send_interruptible( const rgb (&values)[array_size], uint8_t bit)
+{
+    send_interruptible( &values[0], array_size, bit);
+}
+
+template< typename port_type, uint16_t array_size>
+inline void send_interruptible( const rgb (&values)[array_size], uint8_t bit)
+{
+    send_interruptible<port_type>( &values[0], array_size, bit);
+}
+
 template< uint16_t array_size>
 inline rgb& get( rgb (&values)[array_size], uint16_t index)
 {
 	return values[index];
 }
 
+/**
+ * Write 'count' consecutive LED values, starting at the given position.
+ * For sparse buffers this is much cheaper than writing the values one by one through get().
+ */
 template< uint16_t array_size>
-inline void clear( rgb (&values)[array_size])
+inline void write_run( rgb (&values)[array_size], uint16_t position, const rgb *run, uint16_t count)
 {
-	memset( (void *)values, 0, sizeof values);
+    memcpy( &values[position], run, count * sizeof( rgb));
 }
 
+/**
+ * Add 'count' consecutive LED values, with clipping, starting at the given position.
+ */
 template< uint16_t array_size>
-inline void fill( rgb (&values)[array_size], const rgb &value)
+inline void add_run( rgb (&values)[array_size], uint16_t position, const rgb *run, uint16_t count)
+{
+    rgb *target = &values[position];
+    while (count--) add_clipped( *target++, *run++);
+}
+
+/**
+ * write_run() and add_run() for buffer types that give access to their LEDs through get().
+ * Buffer types with their own write semantics, such as sparse_leds and segments, provide their own overloads.
+ */
+template< typename buffer_type>
+inline void write_run( buffer_type &leds, uint16_t position, const rgb *run, uint16_t count)
 {
-    for (uint16_t count = 0; count < array_size; ++count)
+    while (count--) get( leds, position++) = *run++;
+}
+
+template< typename buffer_type>
+inline void add_run( buffer_type &leds, uint16_t position, const rgb *run, uint16_t count)
+{
+    while (count--)
     {
-        values[count] = value;
+        rgb value = get( leds, position);
+        add_clipped( value, *run++);
+        get( leds, position++) = value;
     }
 }
 
+/**
+ * Make 'count' consecutive LEDs black, starting at the given position.
+ */
+template< uint16_t array_size>
+inline void clear_run( rgb (&values)[array_size], uint16_t position, uint16_t count)
+{
+    memset( (void *)&values[position], 0, count * sizeof( rgb));
+}
+
+template< typename buffer_type>
+inline void clear_run( buffer_type &leds, uint16_t position, uint16_t count)
+{
+    while (count--) get( leds, position++) = rgb();
+}
+
+namespace detail {
+inline rgb scaled( const rgb &color, uint8_t amplitude, const rgb &offset)
+{
+    return rgb(
+            offset.red   + ((static_cast<uint16_t>( color.red)   * amplitude) >> 8),
+            offset.green + ((static_cast<uint16_t>( color.green) * amplitude) >> 8),
+            offset.blue  + ((static_cast<uint16_t>( color.blue)  * amplitude) >> 8));
+}
+}
+
+/**
+ * Set an LED to offset + color x amplitude / 256, without clipping.
+ * Buffers with more than 8 bits per channel (see dither.hpp) keep the fraction that is dropped here.
+ */
+template< uint16_t array_size>
+inline void set_scaled( rgb (&values)[array_size], uint16_t index, const rgb &color, uint8_t amplitude, const rgb &offset = rgb())
+{
+    values[index] = detail::scaled( color, amplitude, offset);
+}
+
+/**
+ * set_scaled() for buffer types that give access to their LEDs by reference through get().
+ */
+template< typename buffer_type>
+inline void set_scaled( buffer_type &leds, uint16_t index, const rgb &color, uint8_t amplitude, const rgb &offset = rgb())
+{
+    get( leds, index) = detail::scaled( color, amplitude, offset);
+}
+
 template< uint16_t array_size>
 struct led_buffer_traits<rgb[array_size]>
 {
 	static const uint16_t count = array_size;
 	static const uint16_t size = sizeof( rgb) * array_size;
+
+	typedef rgb *iterator;
+	static const bool contiguous = true;
+	static iterator begin( rgb (&values)[array_size]) { return values; }
+	static iterator end( rgb (&values)[array_size]) { return values + array_size; }
 };
+
+template< typename buffer_type>
+inline typename led_buffer_traits<buffer_type>::iterator begin( buffer_type &leds)
+{
+    return led_buffer_traits<buffer_type>::begin( leds);
+}
+
+template< typename buffer_type>
+inline typename led_buffer_traits<buffer_type>::iterator end( buffer_type &leds)
+{
+    return led_buffer_traits<buffer_type>::end( leds);
+}
+
+namespace detail {
+template< typename iterator>
+inline void fill_range( iterator first, iterator last, const rgb &value)
+{
+    for (; first != last; ++first) *first = value;
+}
+
+template< typename iterator>
+inline void clear_range( iterator first, iterator last)
+{
+    fill_range( first, last, rgb());
+}
+
+inline void clear_range( rgb *first, rgb *last)
+{
+    memset( (void *)first, 0, (last - first) * sizeof( rgb));
+}
+
+template< typename iterator>
+inline void scroll_range( iterator first, iterator last, rgb value)
+{
+    for (; first != last; ++first)
+    {
+        const rgb previous = *first;
+        *first = value;
+        value = previous;
+    }
+}
+
+inline void scroll_range( rgb *first, rgb *last, const rgb &value)
+{
+    if (first == last) return;
+    memmove( (void *)(first + 1), first, (last - first - 1) * sizeof( rgb));
+    *first = value;
+}
+}
+
+template< typename buffer_type>
+inline void clear( buffer_type &leds)
+{
+    detail::clear_range( begin( leds), end( leds));
+}
+
+template< typename buffer_type>
+inline void fill( buffer_type &leds, const rgb &value)
+{
+    detail::fill_range( begin( leds), end( leds), value);
+}
+
+/**
+ * Move all LEDs one position up the string, the last LED falls off
+ * and the first LED gets the new value.
+ */
+template< typename buffer_type>
+inline void scroll( buffer_type &leds, const rgb &new_value)
+{
+    detail::scroll_range( begin( leds), end( leds), new_value);
+}
 }
 
 
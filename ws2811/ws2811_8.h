@@ -20,25 +20,21 @@
 namespace ws2811
 {
 
+namespace detail
+{
 /**
- * This function sends the RGB-data in an array of rgb structs through
- * the given io-pin.
- * The port is determined by the macro WS2811_PORT, but the actual pin to
- * be used is an argument to this function. This allows a single instance of this function
- * to control up to 8 separate channels.
+ * This function sends 'size' bytes through the given io-pin, without
+ * resetting the controllers first.
+ * The port is determined by the port_type template argument, the pin is determined by the mask.
  */
-void send( const void *values, uint16_t array_size, uint8_t bit)
+template< typename port_type>
+void send_bytes( const void *values, uint16_t size, uint8_t mask)
 {
-    const uint8_t mask =_BV(bit);
-    uint8_t low_val = WS2811_PORT & (~mask);
-    uint8_t high_val = WS2811_PORT | mask;
-    uint16_t size = array_size * sizeof( rgb); // size in bytes
-
-
-    // reset the controllers by pulling the data line low
+    uint8_t low_val = port_type::port() & (~mask);
+    uint8_t high_val = port_type::port() | mask;
     uint8_t bitcount = 7;
-    WS2811_PORT = low_val;
-    _delay_loop_1(107); // at 3 clocks per iteration, this is 320 ticks or 40us at 8Mhz
+    const uint8_t *ptr = static_cast<const uint8_t *>( values);
+
 
     // The labels in this piece of assembly code aren't very explanatory. The real documentation
     // of this code can be found in the spreadsheet ws2811@8Mhz.ods
@@ -55,48 +51,229 @@ void send( const void *values, uint16_t array_size, uint8_t bit)
     // The two-digit suffix of labels shows the "phase" of the signal at the time
     // of the execution, 00 being the first clock tick of the bit and 09 being the last.
     asm volatile(
-    		"start:  LDI %[bits], 7                          \n" // start code, load bit count
+    		"start%=: LDI %[bits], 7                         \n" // start code, load bit count
     		"        LD __tmp_reg__, %a[dataptr]+            \n" // fetch first byte
-    		"cont06: NOP                                     \n"
-    		"cont07: NOP                                     \n"
+    		"cont06%=: NOP                                   \n"
+    		"cont07%=: NOP                                   \n"
     		"        OUT %[portout], %[downreg]              \n" // Force line down, even if it already was down
-    		"cont09: LSL __tmp_reg__                         \n" // Load next bit into carry flag.
-    		"s00:    OUT %[portout], %[upreg]                \n" // Start of bit, bit value is in carry flag
-    		"        BRCS skip03                             \n" // only lower the line if the bit...
+    		"cont09%=: LSL __tmp_reg__                       \n" // Load next bit into carry flag.
+    		"s00%=:  OUT %[portout], %[upreg]                \n" // Start of bit, bit value is in carry flag
+    		"        BRCS skip03%=                           \n" // only lower the line if the bit...
     		"        OUT %[portout], %[downreg]              \n" // ...in the carry flag was zero.
-    		"skip03: SUBI %[bits], 1                         \n" // Decrease bit count...
-    		"        BRNE cont06                             \n" // ...and loop if not zero
+    		"skip03%=: SUBI %[bits], 1                       \n" // Decrease bit count...
+    		"        BRNE cont06%=                           \n" // ...and loop if not zero
     		"        LSL __tmp_reg__                         \n" // Load the last bit into the carry flag
-    		"        BRCC Lx008                              \n" // Jump if last bit is zero
+    		"        BRCC Lx008%=                            \n" // Jump if last bit is zero
     		"        LDI %[bits], 7                          \n" // Reset bit counter to 7
     		"        OUT %[portout], %[downreg]              \n" // Force line down, even if it already was down
     		"        NOP                                     \n"
     		"        OUT %[portout], %[upreg]                \n" // Start of last bit of byte, which is 1
     		"        SBIW %[bytes], 1                        \n" // Decrease byte count
     		"        LD __tmp_reg__, %a[dataptr]+            \n" // Load next byte
-    		"        BRNE cont07                             \n" // Loop if byte count is not zero
-    		"        RJMP brk18                              \n" // Byte count is zero, jump to the end
-    		"Lx008:  OUT %[portout], %[downreg]              \n" // Last bit is zero
+    		"        BRNE cont07%=                           \n" // Loop if byte count is not zero
+    		"        RJMP brk18%=                            \n" // Byte count is zero, jump to the end
+    		"Lx008%=: OUT %[portout], %[downreg]             \n" // Last bit is zero
     		"        LDI %[bits], 7                          \n" // Reset bit counter to 7
     		"        OUT %[portout], %[upreg]                \n" // Start of last bit of byte, which is 0
     		"        NOP                                     \n"
     		"        OUT %[portout], %[downreg]              \n" // We know we're transmitting a 0
     		"        SBIW %[bytes], 1                        \n" // Decrease byte count
     		"        LD __tmp_reg__, %a[dataptr]+            \n"
-    		"        BRNE cont09                             \n" // Loop if byte count is not zero
-    		"brk18:  OUT %[portout], %[downreg]              \n"
+    		"        BRNE cont09%=                           \n" // Loop if byte count is not zero
+    		"brk18%=: OUT %[portout], %[downreg]             \n"
     		"                                                \n" // used to be a NOP here, but returning from the function takes long enough
     		"                                                \n" // We're done.
-: /* no output */
+: /* outputs */
+[dataptr] "+e" (ptr),       // pointer to grb values
+[bytes]   "+w" (size),      // number of bytes to send
+[bits]    "+d" (bitcount)   // number of bits/2
+: /* inputs */
+[upreg]   "r" (high_val),   // register that contains the "up" value for the output port (constant)
+[downreg] "r" (low_val),    // register that contains the "down" value for the output port (constant)
+[portout] "I" (_SFR_IO_ADDR(port_type::port())) // The port to use
+: "memory"                  // the asm reads the bytes that 'values' points to
+    );
+
+}
+
+/**
+ * Send bytes on the port given by the WS2811_PORT macro.
+ */
+inline void send_bytes( const void *values, uint16_t size, uint8_t mask)
+{
+    send_bytes<default_port>( values, size, mask);
+}
+}
+
+/**
+ * This function sends the RGB-data in an array of rgb structs through
+ * the given io-pin.
+ * The port is determined by the port_type template argument, but the actual pin to
+ * be used is an argument to this function. This allows a single instance of this function
+ * to control up to 8 separate channels.
+ */
+template< typename port_type>
+void send( const void *values, uint16_t array_size, uint8_t bit)
+{
+    const uint8_t mask =_BV(bit);
+    detail::reset<port_type>( bit);
+    detail::send_bytes<port_type>( values, array_size * sizeof( rgb), mask);
+    detail::end_frame<port_type>( bit);
+}
+
+/**
+ * Send RGB-data on the port given by the WS2811_PORT macro.
+ */
+inline void send( const void *values, uint16_t array_size, uint8_t bit)
+{
+    send<default_port>( values, array_size, bit);
+}
+
+/**
+ * This function sends the RGB-data in an array of rgb structs through the given io-pin,
+ * but instead of sending the bytes in the order in which they appear in memory, it
+ * sends the bytes at memory offsets 'first', 'second' and 'third' of each LED.
+ *
+ * This allows LED strings that expect their colors in a different order to be driven
+ * from the same rgb buffer, without a separate pass over the buffer to swap bytes.
+ *
+ * The timing of the waveform is the same as that of send(). The code below is the
+ * main loop of send(), unrolled three times, once for each byte of an LED. The spare
+ * cycles that are used for the byte count in send() are used here to load the next
+ * byte from a fixed offset and, once per LED, to advance the data pointer by three.
+ * The byte count is only decreased after the third byte, so 'leds' counts LEDs, not bytes.
+ */
+template< uint8_t first, uint8_t second, uint8_t third, typename port_type>
+void send_permuted( const void *values, uint16_t leds, uint8_t bit)
+{
+    if (first == 0 && second == 1 && third == 2)
+    {
+        // If the bytes are requested in memory order, just use the regular send() function.
+        send<port_type>( values, leds, bit);
+        return;
+    }
+
+    const uint8_t mask =_BV(bit);
+    uint8_t low_val = port_type::port() & (~mask);
+    uint8_t high_val = port_type::port() | mask;
+    const uint8_t *ptr = static_cast<const uint8_t *>( values);
+
+    // reset the controllers by pulling the data line low
+    uint8_t bitcount = 7;
+    detail::reset<port_type>( bit);
+
+    // Labels start with a letter that determines which byte of the LED is being sent ('a', 'b' or 'c')
+    // followed by the phase and a unique number (%=), so that this function can be instantiated more than once.
+    asm volatile(
+            "        LDD __tmp_reg__, %a[dataptr]+%[first]   \n" // fetch first byte
+            // first byte of each LED
+            "a06%=:  NOP                                     \n"
+            "a07%=:  NOP                                     \n"
+            "        OUT %[portout], %[downreg]              \n" // Force line down, even if it already was down
+            "a09%=:  LSL __tmp_reg__                         \n" // Load next bit into carry flag.
+            "        OUT %[portout], %[upreg]                \n" // Start of bit, bit value is in carry flag
+            "        BRCS a03%=                              \n" // only lower the line if the bit...
+            "        OUT %[portout], %[downreg]              \n" // ...in the carry flag was zero.
+            "a03%=:  SUBI %[bits], 1                         \n" // Decrease bit count...
+            "        BRNE a06%=                              \n" // ...and loop if not zero
+            "        LSL __tmp_reg__                         \n" // Load the last bit into the carry flag
+            "        BRCC a18%=                              \n" // Jump if last bit is zero
+            "        LDI %[bits], 7                          \n" // Reset bit counter to 7
+            "        OUT %[portout], %[downreg]              \n" // Force line down, even if it already was down
+            "        NOP                                     \n"
+            "        OUT %[portout], %[upreg]                \n" // Start of last bit of byte, which is 1
+            "        LDD __tmp_reg__, %a[dataptr]+%[second]  \n" // Load next byte
+            "        NOP                                     \n"
+            "        NOP                                     \n"
+            "        RJMP b07%=                              \n"
+            "a18%=:  OUT %[portout], %[downreg]              \n" // Last bit is zero
+            "        LDI %[bits], 7                          \n" // Reset bit counter to 7
+            "        OUT %[portout], %[upreg]                \n" // Start of last bit of byte, which is 0
+            "        NOP                                     \n"
+            "        OUT %[portout], %[downreg]              \n" // We know we're transmitting a 0
+            "        LDD __tmp_reg__, %a[dataptr]+%[second]  \n" // Load next byte
+            "        NOP                                     \n"
+            "        NOP                                     \n"
+            "        RJMP b09%=                              \n"
+            // second byte of each LED
+            "b06%=:  NOP                                     \n"
+            "b07%=:  NOP                                     \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "b09%=:  LSL __tmp_reg__                         \n"
+            "        OUT %[portout], %[upreg]                \n"
+            "        BRCS b03%=                              \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "b03%=:  SUBI %[bits], 1                         \n"
+            "        BRNE b06%=                              \n"
+            "        LSL __tmp_reg__                         \n"
+            "        BRCC b18%=                              \n"
+            "        LDI %[bits], 7                          \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "        NOP                                     \n"
+            "        OUT %[portout], %[upreg]                \n"
+            "        LDD __tmp_reg__, %a[dataptr]+%[third]   \n" // Load third byte
+            "        ADIW %[dataptr], 3                      \n" // Let the data pointer point to the next LED
+            "        RJMP c07%=                              \n"
+            "b18%=:  OUT %[portout], %[downreg]              \n"
+            "        LDI %[bits], 7                          \n"
+            "        OUT %[portout], %[upreg]                \n"
+            "        NOP                                     \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "        LDD __tmp_reg__, %a[dataptr]+%[third]   \n"
+            "        ADIW %[dataptr], 3                      \n"
+            "        RJMP c09%=                              \n"
+            // third byte of each LED
+            "c06%=:  NOP                                     \n"
+            "c07%=:  NOP                                     \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "c09%=:  LSL __tmp_reg__                         \n"
+            "        OUT %[portout], %[upreg]                \n"
+            "        BRCS c03%=                              \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "c03%=:  SUBI %[bits], 1                         \n"
+            "        BRNE c06%=                              \n"
+            "        LSL __tmp_reg__                         \n"
+            "        BRCC c18%=                              \n"
+            "        LDI %[bits], 7                          \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "        NOP                                     \n"
+            "        OUT %[portout], %[upreg]                \n" // Start of last bit of the LED, which is 1
+            "        SBIW %[leds], 1                         \n" // Decrease LED count
+            "        LDD __tmp_reg__, %a[dataptr]+%[first]   \n" // Load first byte of the next LED
+            "        BRNE a07%=                              \n" // Loop if LED count is not zero
+            "        RJMP end%=                              \n"
+            "c18%=:  OUT %[portout], %[downreg]              \n" // Last bit is zero
+            "        LDI %[bits], 7                          \n"
+            "        OUT %[portout], %[upreg]                \n"
+            "        NOP                                     \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "        SBIW %[leds], 1                         \n" // Decrease LED count
+            "        LDD __tmp_reg__, %a[dataptr]+%[first]   \n"
+            "        BRNE a09%=                              \n" // Loop if LED count is not zero
+            "end%=:  OUT %[portout], %[downreg]              \n"
+: /* outputs */
+[dataptr] "+b" (ptr),        // pointer to the current LED
+[leds]    "+w" (leds),       // number of LEDs to send
+[bits]    "+d" (bitcount)    // bit counter
 : /* inputs */
-[dataptr] "e" (values), 	// pointer to grb values
-[upreg]   "r" (high_val),	// register that contains the "up" value for the output port (constant)
-[downreg] "r" (low_val),	// register that contains the "down" value for the output port (constant)
-[bytes]   "w" (size),		// number of bytes to send
-[bits]    "d" (bitcount),       // number of bits/2
-[portout] "I" (_SFR_IO_ADDR(WS2811_PORT)) // The port to use
+[upreg]   "r" (high_val),    // register that contains the "up" value for the output port (constant)
+[downreg] "r" (low_val),     // register that contains the "down" value for the output port (constant)
+[first]   "I" (first),       // memory offset of the first byte to send
+[second]  "I" (second),      // memory offset of the second byte to send
+[third]   "I" (third),       // memory offset of the third byte to send
+[portout] "I" (_SFR_IO_ADDR(port_type::port())) // The port to use
+: "memory"                   // the asm reads the LED values
     );
+    detail::end_frame<port_type>( bit);
+}
 
+/**
+ * Send in a permuted order on the port given by the WS2811_PORT macro.
+ */
+template< uint8_t first, uint8_t second, uint8_t third>
+inline void send_permuted( const void *values, uint16_t leds, uint8_t bit)
+{
+    send_permuted< first, second, third, default_port>( values, leds, bit);
 }
 
 }
@@ -22,29 +22,26 @@
 #include <util/delay_basic.h>
 
 #include "../ws2811/rgb.h"
+#include "../ws2811/rgb_operators.hpp"
 
 namespace ws2811
 {
 
+namespace detail
+{
 /**
- * This function sends the RGB-data in an array of rgb structs through
- * the given io-pin.
- * The port is determined by the macro WS2811_PORT, but the actual pin to
- * be used is an argument to this function. This allows a single instance of this function
- * to control up to 8 separate channels.
+ * This function sends 'size' bytes through the given io-pin, without
+ * resetting the controllers first.
+ * The port is determined by the port_type template argument, the pin is determined by the mask.
  */
-void send( const void *values, uint16_t array_size, uint8_t bit)
+template< typename port_type>
+void send_bytes( const void *values, uint16_t size, uint8_t mask)
 {
-    const uint8_t mask =_BV(bit);
-    uint8_t low_val = WS2811_PORT & (~mask);
-    uint8_t high_val = WS2811_PORT | mask;
-    uint16_t size = array_size * sizeof( rgb); // size in bytes
-
-
-    // reset the controllers by pulling the data line low
+    uint8_t low_val = port_type::port() & (~mask);
+    uint8_t high_val = port_type::port() | mask;
     uint8_t bitcount = 7;
-    WS2811_PORT = low_val;
-    _delay_loop_1( 384/3); // 40us = 384 ticks, 3 ticks per loop
+    const uint8_t *ptr = static_cast<const uint8_t *>( values);
+
 
     // The documentationof this code, including a graphical representation of the waveform
     // can be found in the spreadsheet ws2811@9.6Mhz.ods, in the tab "reduced footprint  9.6"
@@ -52,43 +49,206 @@ void send( const void *values, uint16_t array_size, uint8_t bit)
     // the phase of the waveform that the code at that label position is in.
     // Jumps to labels of the form spbrknn are there to have single instruction words that take 2 cycles
     asm volatile(
-    		"spstart:  LD __tmp_reg__, %a[dataptr]+            \n"
-    		"sps00:    OUT %[portout], %[upreg]                \n" //    at this point the bits are in '__tmp_reg__'
+    		"spstart%=: LD __tmp_reg__, %a[dataptr]+           \n"
+    		"sps00%=:  OUT %[portout], %[upreg]                \n" //    at this point the bits are in '__tmp_reg__'
     		"          LSL __tmp_reg__                         \n" //    get leftmost of the remaining bits
-    		"          BRCS spskip04                           \n" //    skip the next instruction if it is 1
+    		"          BRCS spskip04%=                         \n" //    skip the next instruction if it is 1
     		"          OUT %[portout], %[downreg]              \n" //    pull the line down if it was a zero
-    		"spskip04: RJMP spbrk0                             \n"
-    		"spbrk0:   SUBI %[bits], 1                         \n" //    decrease bit counter...
-    		"          BRNE spcont09                           \n" //    ...and make sure we loop if it's not zero yet
+    		"spskip04%=: RJMP spbrk0%=                         \n"
+    		"spbrk0%=: SUBI %[bits], 1                         \n" //    decrease bit counter...
+    		"          BRNE spcont09%=                         \n" //    ...and make sure we loop if it's not zero yet
     		"          LDI %[bits], 7                          \n" //    bitcounter was zero, reset to 7
     		"          OUT %[portout], %[downreg]              \n" //    has no effect if the line was already down
-    		"          RJMP spbrk10                            \n"
-    		"spcont09: OUT %[portout], %[downreg]              \n"
-    		"          RJMP sps00                              \n"
-    		"spbrk10:  OUT %[portout], %[upreg]                \n"
+    		"          RJMP spbrk10%=                          \n"
+    		"spcont09%=: OUT %[portout], %[downreg]            \n"
+    		"          RJMP sps00%=                            \n"
+    		"spbrk10%=: OUT %[portout], %[upreg]               \n"
     		"          LSL __tmp_reg__                         \n" //    get the final bit
-    		"          BRCS spskip14                           \n"
+    		"          BRCS spskip14%=                         \n"
     		"          OUT %[portout], %[downreg]              \n"
-    		"spskip14: NOP                                     \n"
+    		"spskip14%=: NOP                                   \n"
     		"          LD __tmp_reg__, %a[dataptr]+            \n" //    load either next data byte or zero count
     		"          SBIW %[bytes], 1                        \n" //    do we need to send another byte?
     		"          OUT %[portout], %[downreg]              \n"
-    		"          BRNE sps00                              \n" //    jump to the start if we do.
+    		"          BRNE sps00%=                            \n" //    jump to the start if we do.
     		"          NOP                                     \n"
-    		"spend:    OUT %[portout], %[downreg]              \n"
+    		"spend%=:  OUT %[portout], %[downreg]              \n"
 
-: /* no output */
+: /* outputs */
+[dataptr] "+e" (ptr),       // pointer to grb values
+[bytes]   "+w" (size),      // number of bytes to send
+[bits]    "+d" (bitcount)   // number of bits/2
 : /* inputs */
-[dataptr] "e" (values), 	// pointer to grb values
-[upreg]   "r" (high_val),	// register that contains the "up" value for the output port (constant)
-[downreg] "r" (low_val),	// register that contains the "down" value for the output port (constant)
-[bytes]   "w" (size),			// number of bytes to send
-[bits]    "d" (bitcount),       // number of bits/2
-[portout] "I" (_SFR_IO_ADDR(WS2811_PORT)) // The port to use
+[upreg]   "r" (high_val),   // register that contains the "up" value for the output port (constant)
+[downreg] "r" (low_val),    // register that contains the "down" value for the output port (constant)
+[portout] "I" (_SFR_IO_ADDR(port_type::port())) // The port to use
+: "memory"                  // the asm reads the bytes that 'values' points to
     );
 
 }
 
+/**
+ * Send bytes on the port given by the WS2811_PORT macro.
+ */
+inline void send_bytes( const void *values, uint16_t size, uint8_t mask)
+{
+    send_bytes<default_port>( values, size, mask);
+}
+}
+
+/**
+ * This function sends the RGB-data in an array of rgb structs through
+ * the given io-pin.
+ * The port is determined by the port_type template argument, but the actual pin to
+ * be used is an argument to this function. This allows a single instance of this function
+ * to control up to 8 separate channels.
+ */
+template< typename port_type>
+void send( const void *values, uint16_t array_size, uint8_t bit)
+{
+    const uint8_t mask =_BV(bit);
+    detail::reset<port_type>( bit);
+    detail::send_bytes<port_type>( values, array_size * sizeof( rgb), mask);
+    detail::end_frame<port_type>( bit);
+}
+
+/**
+ * Send RGB-data on the port given by the WS2811_PORT macro.
+ */
+inline void send( const void *values, uint16_t array_size, uint8_t bit)
+{
+    send<default_port>( values, array_size, bit);
+}
+
+/**
+ * This function sends the RGB-data in an array of rgb structs through the given io-pin,
+ * but instead of sending the bytes in the order in which they appear in memory, it
+ * sends the bytes at memory offsets 'first', 'second' and 'third' of each LED.
+ *
+ * This allows LED strings that expect their colors in a different order to be driven
+ * from the same rgb buffer, without a separate pass over the buffer to swap bytes.
+ *
+ * The waveform is identical to that of send(). The code is the main loop of send(), unrolled
+ * three times, once for each byte of an LED. The cycles that send() spends on decreasing the byte
+ * count are used to advance the data pointer once per LED, loads use a fixed offset from
+ * that pointer. Note that 'leds' counts LEDs, not bytes.
+ */
+template< uint8_t first, uint8_t second, uint8_t third, typename port_type>
+void send_permuted( const void *values, uint16_t leds, uint8_t bit)
+{
+    if (first == 0 && second == 1 && third == 2)
+    {
+        // If the bytes are requested in memory order, just use the regular send() function.
+        send<port_type>( values, leds, bit);
+        return;
+    }
+
+    const uint8_t mask =_BV(bit);
+    uint8_t low_val = port_type::port() & (~mask);
+    uint8_t high_val = port_type::port() | mask;
+    const uint8_t *ptr = static_cast<const uint8_t *>( values);
+
+    // reset the controllers by pulling the data line low
+    uint8_t bitcount = 7;
+    detail::reset<port_type>( bit);
+
+    // Labels start with a letter that determines which byte of the LED is being sent ('a', 'b' or 'c')
+    // followed by the phase and a unique number (%=), so that this function can be instantiated more than once.
+    asm volatile(
+            "        LDD __tmp_reg__, %a[dataptr]+%[first]   \n"
+            // first byte of each LED
+            "a00%=:  OUT %[portout], %[upreg]                \n" //    at this point the bits are in '__tmp_reg__'
+            "        LSL __tmp_reg__                         \n" //    get leftmost of the remaining bits
+            "        BRCS a04%=                              \n" //    skip the next instruction if it is 1
+            "        OUT %[portout], %[downreg]              \n" //    pull the line down if it was a zero
+            "a04%=:  RJMP a05%=                              \n"
+            "a05%=:  SUBI %[bits], 1                         \n" //    decrease bit counter...
+            "        BRNE a09%=                              \n" //    ...and make sure we loop if it's not zero yet
+            "        LDI %[bits], 7                          \n" //    bitcounter was zero, reset to 7
+            "        OUT %[portout], %[downreg]              \n" //    has no effect if the line was already down
+            "        RJMP a10%=                              \n"
+            "a09%=:  OUT %[portout], %[downreg]              \n"
+            "        RJMP a00%=                              \n"
+            "a10%=:  OUT %[portout], %[upreg]                \n"
+            "        LSL __tmp_reg__                         \n" //    get the final bit
+            "        BRCS a14%=                              \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "a14%=:  NOP                                     \n"
+            "        LDD __tmp_reg__, %a[dataptr]+%[second]  \n" //    load the second byte
+            "        RJMP a17%=                              \n"
+            "a17%=:  OUT %[portout], %[downreg]              \n"
+            "        RJMP b00%=                              \n"
+            // second byte of each LED
+            "b00%=:  OUT %[portout], %[upreg]                \n"
+            "        LSL __tmp_reg__                         \n"
+            "        BRCS b04%=                              \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "b04%=:  RJMP b05%=                              \n"
+            "b05%=:  SUBI %[bits], 1                         \n"
+            "        BRNE b09%=                              \n"
+            "        LDI %[bits], 7                          \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "        RJMP b10%=                              \n"
+            "b09%=:  OUT %[portout], %[downreg]              \n"
+            "        RJMP b00%=                              \n"
+            "b10%=:  OUT %[portout], %[upreg]                \n"
+            "        LSL __tmp_reg__                         \n"
+            "        BRCS b14%=                              \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "b14%=:  NOP                                     \n"
+            "        LDD __tmp_reg__, %a[dataptr]+%[third]   \n" //    load the third byte
+            "        ADIW %[dataptr], 3                      \n" //    let the data pointer point to the next LED
+            "        OUT %[portout], %[downreg]              \n"
+            "        RJMP c00%=                              \n"
+            // third byte of each LED
+            "c00%=:  OUT %[portout], %[upreg]                \n"
+            "        LSL __tmp_reg__                         \n"
+            "        BRCS c04%=                              \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "c04%=:  RJMP c05%=                              \n"
+            "c05%=:  SUBI %[bits], 1                         \n"
+            "        BRNE c09%=                              \n"
+            "        LDI %[bits], 7                          \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "        RJMP c10%=                              \n"
+            "c09%=:  OUT %[portout], %[downreg]              \n"
+            "        RJMP c00%=                              \n"
+            "c10%=:  OUT %[portout], %[upreg]                \n"
+            "        LSL __tmp_reg__                         \n"
+            "        BRCS c14%=                              \n"
+            "        OUT %[portout], %[downreg]              \n"
+            "c14%=:  NOP                                     \n"
+            "        LDD __tmp_reg__, %a[dataptr]+%[first]   \n" //    load the first byte of the next LED
+            "        SBIW %[leds], 1                         \n" //    do we need to send another LED?
+            "        OUT %[portout], %[downreg]              \n"
+            "        BRNE a00%=                              \n" //    jump to the start if we do.
+            "        NOP                                     \n"
+            "        OUT %[portout], %[downreg]              \n"
+: /* outputs */
+[dataptr] "+b" (ptr),        // pointer to the current LED
+[leds]    "+w" (leds),       // number of LEDs to send
+[bits]    "+d" (bitcount)    // bit counter
+: /* inputs */
+[upreg]   "r" (high_val),    // register that contains the "up" value for the output port (constant)
+[downreg] "r" (low_val),     // register that contains the "down" value for the output port (constant)
+[first]   "I" (first),       // memory offset of the first byte to send
+[second]  "I" (second),      // memory offset of the second byte to send
+[third]   "I" (third),       // memory offset of the third byte to send
+[portout] "I" (_SFR_IO_ADDR(port_type::port())) // The port to use
+: "memory"                   // the asm reads the LED values
+    );
+    detail::end_frame<port_type>( bit);
+}
+
+/**
+ * Send in a permuted order on the port given by the WS2811_PORT macro.
+ */
+template< uint8_t first, uint8_t second, uint8_t third>
+inline void send_permuted( const void *values, uint16_t leds, uint8_t bit)
+{
+    send_permuted< first, second, third, default_port>( values, leds, bit);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // This part of the file contains functions for sparse LED string buffers.
 
@@ -109,20 +269,94 @@ void send( const void *values, uint16_t array_size, uint8_t bit)
  * A buffer is terminated by a zero <jump> value or a zero <count>. The first <jump>
  * never terminates the sequence, even if it is zero. A zero <jump> count at the start
  * means the string starts with a lit LED.
+ *
+ * The buffer keeps track of the number of bytes in use. When a write does not fit, the buffer is
+ * first compacted (see compact()), and if that does not free enough room the write is dropped and
+ * counted in 'overflows'. Together with 'peak', this shows whether the buffer size chosen for an effect
+ * is too small or unnecessarily big.
  */
 template<uint8_t buffer_size, uint8_t led_string_size>
 struct sparse_leds
 {
 	uint8_t buffer[buffer_size];
+	uint8_t used;		///< number of bytes in the buffer that are in use, including the terminating jump and count.
+	uint8_t peak;		///< highest value of 'used' since the last call to reset_statistics()
+	uint8_t overflows;	///< number of writes that were dropped because the buffer was full, stops at 255.
+};
+
+/**
+ * Cursor over the LEDs that are stored in a sparse buffer.
+ *
+ * Only the LEDs in the blocks are visited, the black LEDs between blocks are skipped.
+ * position() returns the position in the LED string of the current LED.
+ */
+class sparse_iterator
+{
+public:
+	/// creates the end iterator.
+	sparse_iterator()
+	:data( 0), remaining( 0), led( 0)
+	{}
+
+	/// creates an iterator at the first stored LED of a sparse buffer.
+	explicit sparse_iterator( uint8_t *buffer)
+	:data( buffer), remaining( 0), led( 0)
+	{
+		enter_block( true);
+	}
+
+	rgb &operator*() const
+	{
+		return *reinterpret_cast<rgb *>( data);
+	}
+
+	rgb *operator->() const
+	{
+		return reinterpret_cast<rgb *>( data);
+	}
+
+	sparse_iterator &operator++()
+	{
+		data += 3;
+		++led;
+		if (!--remaining) enter_block( false);
+		return *this;
+	}
+
+	bool operator==( const sparse_iterator &other) const
+	{
+		return data == other.data;
+	}
+
+	bool operator!=( const sparse_iterator &other) const
+	{
+		return data != other.data;
+	}
 
-	/// move the range [begin, end> towards buffer_end.
-	/// buffer_end must be higher than end, for this function to work correctly.
-	/// The bytes that become available are filled with zeros.
-	static void move_right( uint8_t *begin, uint8_t *end, uint8_t *buffer_end)
+	uint8_t position() const
 	{
-		while (begin < end) *(--buffer_end) = *(--end);
-		while( begin < buffer_end) *(--buffer_end) = 0;
+		return led;
 	}
+
+private:
+	/// data points at a jump and a count, move to the first LED of that block or become the end iterator.
+	void enter_block( bool first)
+	{
+		if (data[1] && (first || data[0]))
+		{
+			led += data[0];
+			remaining = data[1];
+			data += 2;
+		}
+		else
+		{
+			data = 0;
+		}
+	}
+
+	uint8_t *data;
+	uint8_t remaining;
+	uint8_t led;
 };
 
 /**
@@ -137,6 +371,11 @@ struct led_buffer_traits<sparse_leds<buffer_size, led_string_size> >
 {
 	static const uint8_t count = led_string_size;
 	static const uint8_t size = buffer_size;
+
+	typedef sparse_iterator iterator;
+	static const bool contiguous = false;
+	static iterator begin( sparse_leds<buffer_size, led_string_size> &leds) { return iterator( leds.buffer); }
+	static iterator end( sparse_leds<buffer_size, led_string_size> &) { return iterator(); }
 };
 
 /**
@@ -148,8 +387,184 @@ inline void clear( sparse_leds<buffer_size, led_string_size> &leds)
 {
 	leds.buffer[0] = led_string_size;
 	leds.buffer[1] = 0;
+	leds.used = 2;
+}
+
+/**
+ * Restart measuring the peak usage and the number of overflows of a sparse buffer.
+ */
+template<uint8_t buffer_size, uint8_t led_string_size>
+inline void reset_statistics( sparse_leds<buffer_size, led_string_size> &leds)
+{
+	leds.peak = leds.used;
+	leds.overflows = 0;
 }
 
+namespace detail {
+/// true if p points at the start of a block, false if it points at the end of the buffer.
+inline bool is_block( const uint8_t *p, const uint8_t *begin, const uint8_t *end)
+{
+	return p + 1 < end && p[1] && (p == begin || p[0]);
+}
+}
+
+/**
+ * Remove black LEDs from a sparse buffer.
+ *
+ * Effects that fade or overwrite LEDs can leave black LEDs in the blocks of a sparse buffer.
+ * This function re-encodes the buffer in place so that every block holds a run of lit LEDs only:
+ * black LEDs at the edges of a block are dropped and a block is split where it contains black LEDs.
+ * Blocks that end up touching each other are merged. Blocks that are separated by black LEDs are never
+ * merged, because storing a black LED takes three bytes while starting a new block takes only two.
+ *
+ * This is called automatically when a write does not fit in the buffer. It takes roughly 20 clock ticks
+ * per stored LED.
+ */
+template<uint8_t buffer_size, uint8_t led_string_size>
+void compact( sparse_leds<buffer_size, led_string_size> &leds)
+{
+	uint8_t * const begin = &leds.buffer[0];
+	uint8_t * const end = begin + buffer_size;
+	uint8_t *read = begin;
+	uint8_t *write = begin;
+	uint8_t *block = 0;		// the block that is being written
+	uint8_t led = 0;		// position in the LED string of the value that 'read' points at
+	uint8_t lit_end = 0;	// one past the last LED that was written
+
+	// the output is never bigger than the input, so 'write' never overtakes 'read'.
+	while (detail::is_block( read, begin, end))
+	{
+		uint8_t count = read[1];
+		led += read[0];
+		read += 2;
+		for (; count; --count, ++led, read += 3)
+		{
+			if (read[0] | read[1] | read[2])
+			{
+				if (!block || led != lit_end)
+				{
+					block = write;
+					write[0] = led - lit_end;
+					write[1] = 0;
+					write += 2;
+				}
+				++block[1];
+				write[0] = read[0];
+				write[1] = read[1];
+				write[2] = read[2];
+				write += 3;
+				lit_end = led + 1;
+			}
+		}
+	}
+
+	write[0] = led_string_size - lit_end;
+	write[1] = 0;
+	leds.used = write + 2 - begin;
+}
+
+
+namespace detail {
+
+/**
+ * Make sure that the LEDs [position, position + count> are stored in a single block of a sparse
+ * buffer, by merging the new range with all blocks that overlap or touch it. LED values that were
+ * already stored keep their value, the other LEDs in the range become black.
+ *
+ * This walks the blocks once to find the blocks that need to be merged, moves the rest of the buffer
+ * once and then moves the data of each merged block to its new place, last block first.
+ * Because blocks are always at least one LED apart, the merged block never takes fewer bytes
+ * than the blocks that it replaces, so all data moves to the right.
+ *
+ * Returns a pointer to the value of the LED at 'position', or zero if the merged block does not fit
+ * in the buffer, even after compacting it.
+ */
+template<uint8_t buffer_size, uint8_t led_string_size>
+rgb *open_run( sparse_leds<buffer_size, led_string_size> &leds, uint8_t position, uint8_t count, bool compacted = false)
+{
+	uint8_t * const begin = &leds.buffer[0];
+	uint8_t * const end = begin + buffer_size;
+	const uint8_t run_end = position + count;
+
+	// find the first block that does not end before 'position'.
+	uint8_t *first = begin;
+	uint8_t led = 0; // one past the last led of the previous block
+	while (is_block( first, begin, end) && led + first[0] + first[1] < position)
+	{
+		led += first[0] + first[1];
+		first += 2 + 3 * first[1];
+	}
+	const uint8_t previous_end = led;
+
+	// find all blocks that overlap or touch the range and the first block after them.
+	uint8_t merged_start = position;
+	uint8_t merged_end = run_end;
+	uint8_t touched = 0;
+	uint8_t *next = first;
+	while (is_block( next, begin, end) && led + next[0] <= run_end)
+	{
+		const uint8_t start = led + next[0];
+		if (start < merged_start) merged_start = start;
+		led = start + next[1];
+		if (led > merged_end) merged_end = led;
+		next += 2 + 3 * next[1];
+		++touched;
+	}
+	const uint8_t next_start = led + next[0];
+
+	// make room for the merged block by moving everything after it to the right
+	const uint8_t merged_count = merged_end - merged_start;
+	uint8_t * const data = first + 2;
+	uint8_t * const new_next = data + 3 * merged_count;
+	const uint16_t used = leds.used + (new_next - next);
+	if (used > buffer_size)
+	{
+		if (!compacted)
+		{
+			compact( leds);
+			return open_run( leds, position, count, true);
+		}
+		if (leds.overflows != 255) ++leds.overflows;
+		return 0;
+	}
+	if (new_next != next)
+	{
+		memmove( new_next, next, leds.used - (next - begin));
+		leds.used = used;
+		if (used > leds.peak) leds.peak = used;
+	}
+
+	// move the led values of the merged blocks to their place, last block first,
+	// and make the gaps between them black.
+	uint8_t *covered = new_next;
+	while (touched)
+	{
+		uint8_t *block = first;
+		led = previous_end;
+		for (uint8_t index = 1; index < touched; ++index)
+		{
+			led += block[0] + block[1];
+			block += 2 + 3 * block[1];
+		}
+		uint8_t * const destination = data + 3 * (led + block[0] - merged_start);
+		const uint8_t bytes = 3 * block[1];
+		if (destination != block + 2)
+		{
+			memmove( destination, block + 2, bytes);
+		}
+		memset( destination + bytes, 0, covered - destination - bytes);
+		covered = destination;
+		--touched;
+	}
+	memset( data, 0, covered - data);
+
+	first[0] = merged_start - previous_end;
+	first[1] = merged_count;
+	new_next[0] = next_start - merged_end;
+
+	return reinterpret_cast<rgb *>( data + 3 * (position - merged_start));
+}
+}
 
 /**
  * Given a sparse buffer and a position in the LED string, find the position in
@@ -162,6 +577,9 @@ inline void clear( sparse_leds<buffer_size, led_string_size> &leds)
  * than the argument 'position' to this function. This function makes sure that
  * the sum of <jump>s and <count>s remains the same.
  *
+ * If there is no room for the LED, even after compacting the buffer, a reference to a scratch value
+ * is returned that is not part of the LED string, and the overflow is counted in leds.overflows.
+ *
  * This function is deliberately not implemented as an operator[] of sparse_leds, because
  * using an explicit function call makes it clear that code is being run and that it is
  * worthwhile to store the result of this function instead of calling the function twice.
@@ -171,90 +589,147 @@ inline void clear( sparse_leds<buffer_size, led_string_size> &leds)
 template<uint8_t buffer_size, uint8_t led_string_size>
 rgb & get( sparse_leds<buffer_size, led_string_size> &leds, uint8_t position)
 {
+	rgb *result = detail::open_run( leds, position, 1);
+	if (result) return *result;
 
-	uint8_t *buffer_iterator = &leds.buffer[0];
-	uint8_t * const end = buffer_iterator + buffer_size;
-	uint8_t current_pos = 0;
-	while (buffer_iterator < end)
-	{
-		// current_pos pointing one past the previous block
-		// buffer_iterator pointing at a 'jump'
+	static rgb scratch;
+	return scratch;
+}
 
-		uint8_t jump_pos = current_pos + *buffer_iterator;
-		if (jump_pos  > position + 1)
-		{
-			// need to add a new block before the one we're pointing at.
-			*buffer_iterator = (jump_pos - position - 1);
-			leds.move_right( buffer_iterator, end - 5, end);
-			*buffer_iterator++ = position - current_pos;
-			*buffer_iterator++=1;
-			break;
-		}
-		current_pos = jump_pos;
-		// current_pos now pointing at the location of the first led in the block
-		if (current_pos  == position + 1)
+/**
+ * Write 'count' consecutive LED values into a sparse buffer, starting at the given position.
+ *
+ * This merges the range with the existing blocks in a single walk over the buffer, where writing
+ * the same values through get() would walk the buffer and possibly move its contents once for every
+ * LED. Writing a run of 12 new LEDs into a buffer that holds 150 bytes through get() costs an estimated
+ * 12 walks and 12 moves of the rest of the buffer, several thousand clock ticks, against roughly 1000 ticks
+ * for a single write_run().
+ */
+template<uint8_t buffer_size, uint8_t led_string_size>
+void write_run( sparse_leds<buffer_size, led_string_size> &leds, uint16_t position, const rgb *values, uint16_t count)
+{
+	rgb *target = count ? detail::open_run( leds, position, count) : 0;
+	if (!target) return;
+	while (count--) *target++ = *values++;
+}
+
+/**
+ * Add 'count' consecutive LED values to a sparse buffer, starting at the given position.
+ * Values are added with clipping, see add_clipped().
+ */
+template<uint8_t buffer_size, uint8_t led_string_size>
+void add_run( sparse_leds<buffer_size, led_string_size> &leds, uint16_t position, const rgb *values, uint16_t count)
+{
+	rgb *target = count ? detail::open_run( leds, position, count) : 0;
+	if (!target) return;
+	while (count--) add_clipped( *target++, *values++);
+}
+
+/**
+ * Make 'count' consecutive LEDs of a sparse buffer black, starting at the given position.
+ * This only overwrites the values that are stored, LEDs that are not stored are black already. It therefore
+ * never needs room in the buffer, the black values are removed when the buffer is compacted.
+ */
+template<uint8_t buffer_size, uint8_t led_string_size>
+void clear_run( sparse_leds<buffer_size, led_string_size> &leds, uint16_t position, uint16_t count)
+{
+	uint8_t * const begin = &leds.buffer[0];
+	uint8_t * const end = begin + buffer_size;
+	const uint16_t run_end = position + count;
+	uint8_t *block = begin;
+	uint16_t led = 0;
+	while (detail::is_block( block, begin, end) && led < run_end)
+	{
+		led += block[0];
+		uint8_t *value = block + 2;
+		for (uint8_t index = block[1]; index; --index, ++led, value += 3)
 		{
-			// prepend the new led to the current block of leds
-			--(*buffer_iterator);
-			++buffer_iterator;
-			++*buffer_iterator;
-			++buffer_iterator;
-			leds.move_right( buffer_iterator, end-3, end);
-			break;
+			if (led >= position && led < run_end) value[0] = value[1] = value[2] = 0;
 		}
-		++buffer_iterator; // pointing at the led block size
-		jump_pos = position - current_pos;
-		if ( jump_pos < *buffer_iterator)
+		block = value;
+	}
+}
+
+/**
+ * Give all LEDs of a sparse buffer the same value.
+ * Unless the value is black, this needs room for all LEDs in a single block.
+ */
+template<uint8_t buffer_size, uint8_t led_string_size>
+void fill( sparse_leds<buffer_size, led_string_size> &leds, const rgb &value)
+{
+	clear( leds);
+	if (!(value == rgb()))
+	{
+		detail::open_run( leds, 0, led_string_size);
+		for (sparse_iterator led = begin( leds); led != end( leds); ++led)
 		{
-			// we're actually pointing to a led that is inside the current block
-			buffer_iterator += (1 + 3 * jump_pos);
-			break;
+			*led = value;
 		}
-		current_pos += *buffer_iterator; // pointing one past the last led in the string.
-		jump_pos = 3 * (*buffer_iterator) + 1;
-		//buffer_iterator += 3 * (*buffer_iterator);
-		if (position == current_pos)
-		{
-			// decrease distance between this block and the next by one
-			if (--(*(buffer_iterator+jump_pos)) == 0)
-			{
-				// distance is zero, concatenate two blocks.
+	}
+}
 
-				// new size is the old size plus the size of the next block plus
-				// 1 for the new led.
-				*buffer_iterator += *(buffer_iterator + jump_pos + 1)+1;
-				buffer_iterator += jump_pos;
-				leds.move_right( buffer_iterator, end - 1, end);
-			}
-			else
-			{
-				// distance is non-zero, just enlarge the current block
-				++*buffer_iterator;
-				buffer_iterator += jump_pos;
-				leds.move_right( buffer_iterator, end - 3, end);
-			}
-			break;
-		}
-		buffer_iterator+=jump_pos;
+/**
+ * Move all LEDs of a sparse buffer one position up the string.
+ * The last LED falls off and the first LED gets the new value.
+ */
+template<uint8_t buffer_size, uint8_t led_string_size>
+void scroll( sparse_leds<buffer_size, led_string_size> &leds, const rgb &new_value)
+{
+	uint8_t * const begin = &leds.buffer[0];
+	uint8_t * const end = begin + buffer_size;
+
+	// find the last block and the end of the sequence.
+	uint8_t *last = 0;
+	uint8_t *terminator = begin;
+	while (detail::is_block( terminator, begin, end))
+	{
+		last = terminator;
+		terminator += 2 + 3 * terminator[1];
+	}
+
+	if (terminator[0] || !last)
+	{
+		// there's at least one black LED at the end of the string.
+		--terminator[0];
+	}
+	else if (last[1] > 1)
+	{
+		// the last block runs up to the end of the string, drop its last LED.
+		--last[1];
+		terminator[-3] = 0;
+		terminator[-2] = 0;
+		leds.used -= 3;
 	}
+	else
+	{
+		// the last block consists of only the last LED, drop the block.
+		last[1] = 0;
+		leds.used -= 5;
+	}
+	++begin[0];
 
-	return *(reinterpret_cast<rgb *>(buffer_iterator));
+	if (!(new_value == rgb()))
+	{
+		get( leds, 0) = new_value;
+	}
 }
 
 /**
  * Send a sparse buffer, containing blocks of LED values interspersed with counts of
- * black LEDs to a WS2811 string, using bit 'bit' of the port determined by the macro
- * WS2811_PORT.
+ * black LEDs to a WS2811 string, using bit 'bit' of the port determined by port_type.
  */
+template< typename port_type>
 void send_sparse( const void *buffer, uint8_t bit )
 {
     const uint8_t mask =_BV(bit);
-    uint8_t low_val = WS2811_PORT & (~mask);
-    uint8_t high_val = WS2811_PORT | mask;
+    uint8_t low_val = port_type::port() & (~mask);
+    uint8_t high_val = port_type::port() | mask;
+    const uint8_t *ptr = static_cast<const uint8_t *>( buffer);
+    uint8_t bytes = 0;
+    uint8_t bits = 0;
+    uint8_t data = 0;
 
-
-    WS2811_PORT = low_val;
-    _delay_loop_1(384/3); // 40us = 384 ticks, 3 ticks per loop
+    detail::reset<port_type>( bit);
 
     // The documentation of this code, including a graphical representation of the waveform
     // can be found in the spreadsheet ws2811@9.6Mhz.ods, in the tab "compact 9.6"
@@ -262,70 +737,79 @@ void send_sparse( const void *buffer, uint8_t bit )
     // the phase of the waveform that the code at that label position is in.
     // Jumps to labels of the form brk<n> are there to have single instruction words that take 2 cycles
     asm volatile(
-    		"start:  LDI %[bits], 23                         \n"
+    		"start%=: LDI %[bits], 23                        \n"
     		"        LD %[data], %a[dataptr]+                \n" //    read how many zero-leds we need to transmit
     		"        TST %[data]                             \n" //
-    		"        BRNE z00                                \n" //    Jump to the zero routine
+    		"        BRNE z00%=                              \n" //    Jump to the zero routine
     		"        LDI %[bits], 7                          \n" //
-    		"        RJMP z11                                \n"
-    		"cont09: OUT %[portout], %[downreg]              \n"
-    		"        RJMP s00                                \n"
-    		"zcont09:NOP                                     \n"
-    		"        RJMP z00                                \n"
-    		"s00:    OUT %[portout], %[upreg]                \n" //    at this point the bits are in '[data]'
+    		"        RJMP z11%=                              \n"
+    		"cont09%=: OUT %[portout], %[downreg]            \n"
+    		"        RJMP s00%=                              \n"
+    		"zcont09%=:NOP                                   \n"
+    		"        RJMP z00%=                              \n"
+    		"s00%=:  OUT %[portout], %[upreg]                \n" //    at this point the bits are in '[data]'
     		"        LSL %[data]                             \n" //    get leftmost of the remaining bits
-    		"        BRCS skip04                             \n" //    skip the next instruction if it is 1
+    		"        BRCS skip04%=                           \n" //    skip the next instruction if it is 1
     		"        OUT %[portout], %[downreg]              \n" //    pull the line down if it was a zero
-    		"skip04: RJMP brk0                               \n" //
-    		"brk0:   SUBI %[bits], 1                         \n" //    decrease bit counter...
-    		"        BRNE cont09                             \n" //    ...and make sure we loop if it's not zero yet
+    		"skip04%=: RJMP brk0%=                           \n" //
+    		"brk0%=: SUBI %[bits], 1                         \n" //    decrease bit counter...
+    		"        BRNE cont09%=                           \n" //    ...and make sure we loop if it's not zero yet
     		"        LDI %[bits], 7                          \n" //    bitcounter was zero, reset to 7
     		"        OUT %[portout], %[downreg]              \n" //    has no effect if the line was already down
-    		"        RJMP brk1                               \n" //
-    		"brk1:   OUT %[portout], %[upreg]                \n" //
+    		"        RJMP brk1%=                             \n" //
+    		"brk1%=: OUT %[portout], %[upreg]                \n" //
     		"        LSL %[data]                             \n" //    get the final bit
-    		"        BRCS skip14                             \n"
+    		"        BRCS skip14%=                           \n"
     		"        OUT %[portout], %[downreg]              \n" //
-    		"skip14: RJMP brk2                               \n" //
-    		"brk2:   LD %[data], %a[dataptr]+                \n" //    load either next [data] byte or zero count
+    		"skip14%=: RJMP brk2%=                           \n" //
+    		"brk2%=: LD %[data], %a[dataptr]+                \n" //    load either next [data] byte or zero count
     		"        SUBI %[bytes], 1                        \n" //    do we need to send another byte?
     		"        OUT %[portout], %[downreg]              \n" //
-    		"        BRNE s00                                \n" //    jump to the start if we do.
+    		"        BRNE s00%=                              \n" //    jump to the start if we do.
     		"        LDI %[bits], 23                         \n" //    prepare for sending 24 bits of zero data
-    		"z00:    OUT %[portout], %[upreg]                \n" //
+    		"z00%=:  OUT %[portout], %[upreg]                \n" //
     		"        TST %[data]                             \n" //    check how many zeros we have to send
-    		"        BREQ end                                \n" //    jump out if it there are none to send.
+    		"        BREQ end%=                              \n" //    jump out if it there are none to send.
     		"        OUT %[portout], %[downreg]              \n" //
-    		"        RJMP brk3                               \n" //
-    		"brk3:   SUBI %[bits], 1                         \n" //
-    		"        BRNE zcont09                            \n" //
+    		"        RJMP brk3%=                             \n" //
+    		"brk3%=: SUBI %[bits], 1                         \n" //
+    		"        BRNE zcont09%=                          \n" //
     		"        SUBI %[data], 1                         \n" //    [data] actually contains 'byte' count (in 3 bytes units)
     		"        LDI %[bits], 24                         \n" //    24, because we are not falling into the lower half
-    		"        BRNE z00                                \n" //
+    		"        BRNE z00%=                              \n" //
     		"        LDI %[bits], 7                          \n" //
     		"        OUT %[portout], %[upreg]                \n" //
-    		"z11:    LD %[data], %a[dataptr]+                \n" //    read the number of leds
+    		"z11%=:  LD %[data], %a[dataptr]+                \n" //    read the number of leds
     		"        OUT %[portout], %[downreg]              \n" //
     		"        MOV %[bytes], %[data]                   \n" //    multiply by three
     		"        ADD %[bytes], %[data]                   \n" //
     		"        ADD %[bytes], %[data]                   \n" //
     		"        LD %[data], %a[dataptr]+                \n" //    read the first byte
-    		"        BREQ z1b                                \n" //    but jump out if the byte count was zero...
-    		"        RJMP s00                                \n"
-    		"z1b:    NOP                                     \n"
-    		"end:    OUT %[portout], %[upreg]                \n"
-    		: /* no output */
+    		"        BREQ z1b%=                              \n" //    but jump out if the byte count was zero...
+    		"        RJMP s00%=                              \n"
+    		"z1b%=:  NOP                                     \n"
+    		"end%=:  OUT %[portout], %[upreg]                \n"
+    		: /* outputs */
+    		[dataptr] "+e" (ptr), 		// pointer to grb values
+    		[bytes]   "+d" (bytes),		// number of bytes to send
+    		[bits]    "+d" (bits),		// number of bits
+    		[data]	  "+d" (data)
     		: /* inputs */
-    		[dataptr] "e" (buffer), 	// pointer to grb values
     		[upreg]   "r" (high_val),	// register that contains the "up" value for the output port (constant)
     		[downreg] "r" (low_val),	// register that contains the "down" value for the output port (constant)
-    		[bytes]   "d" (0),			// number of bytes to send
-    		[bits]    "d" (1),       // number of bits
-    		[data]	  "d" (2),
-    		[portout] "I" (_SFR_IO_ADDR(WS2811_PORT)) // The port to use
+    		[portout] "I" (_SFR_IO_ADDR(port_type::port())) // The port to use
+    		: "memory"
      );
+    detail::end_frame<port_type>( bit);
 
+}
 
+/**
+ * Send a sparse buffer on the port given by the WS2811_PORT macro.
+ */
+inline void send_sparse( const void *buffer, uint8_t bit )
+{
+    send_sparse<default_port>( buffer, bit);
 }
 
 /**
@@ -337,6 +821,12 @@ inline void send( const sparse_leds<buffer_size, led_string_size> &leds, uint8_t
 	send_sparse( leds.buffer,  channel);
 }
 
+template<typename port_type, uint8_t buffer_size, uint8_t led_string_size>
+inline void send( const sparse_leds<buffer_size, led_string_size> &leds, uint8_t channel)
+{
+	send_sparse<port_type>( leds.buffer,  channel);
+}
+
 }
 
 #endif /* WS2811_96_H_ */